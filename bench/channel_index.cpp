@@ -0,0 +1,129 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (C) 2022, KNS Group LLC (YADRO).
+ */
+
+/*
+ * I2C mux channel lookup benchmark: the directory walk done by
+ * getBusByChanName() before the index was added versus common::ChannelIndex.
+ *
+ * A mux symlinks tree (4 muxes x 8 channels by default) is created in a
+ * temporary directory, so the benchmark doesn't need the real hardware.
+ *
+ * Usage: channel-index-bench [lookups] [muxes] [channels]
+ */
+
+#include "common/channel_index.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <system_error>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+static constexpr int symlinkDepth = 1;
+
+/**
+ * @brief Channel lookup as it was done before the index
+ */
+static std::string walkLookup(const fs::path& dir, const std::string& chanName)
+{
+    std::error_code ec;
+    if (!fs::exists(dir, ec))
+    {
+        return std::string();
+    }
+    for (auto p = fs::recursive_directory_iterator(
+             dir, fs::directory_options::follow_directory_symlink);
+         p != fs::recursive_directory_iterator(); ++p)
+    {
+        fs::path path = p->path();
+        if (!is_directory(*p))
+        {
+            if (path.filename() == chanName)
+            {
+                return fs::read_symlink(*p, ec);
+            }
+        }
+        if (p.depth() >= symlinkDepth)
+        {
+            p.disable_recursion_pending();
+        }
+    }
+    return std::string();
+}
+
+template <typename Lookup>
+static double measure(const std::vector<std::string>& names, size_t lookups,
+                      Lookup&& lookup)
+{
+    size_t found = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < lookups; ++i)
+    {
+        found += !lookup(names[i % names.size()]).empty();
+    }
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    if (found != lookups)
+    {
+        fprintf(stderr, "Only %zu of %zu channels found\n", found, lookups);
+        exit(EXIT_FAILURE);
+    }
+    return std::chrono::duration<double, std::nano>(elapsed).count() / lookups;
+}
+
+int main(int argc, char** argv)
+{
+    const size_t lookups = argc > 1 ? strtoul(argv[1], nullptr, 0) : 20000;
+    const int muxes = argc > 2 ? atoi(argv[2]) : 4;
+    const int channels = argc > 3 ? atoi(argv[3]) : 8;
+    if (!lookups || muxes <= 0 || channels <= 0)
+    {
+        fprintf(stderr, "Usage: %s [lookups] [muxes] [channels]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    std::string tmpl = (fs::temp_directory_path() / "i2c-mux-XXXXXX").string();
+    if (!mkdtemp(tmpl.data()))
+    {
+        perror("mkdtemp");
+        return EXIT_FAILURE;
+    }
+    const fs::path dir(tmpl);
+
+    std::vector<std::string> names;
+    int bus = 20;
+    for (int mux = 0; mux < muxes; ++mux)
+    {
+        const fs::path muxDir = dir / ("mux" + std::to_string(mux));
+        fs::create_directory(muxDir);
+        for (int chan = 0; chan < channels; ++chan)
+        {
+            const std::string name =
+                "Chan_" + std::to_string(mux) + "_" + std::to_string(chan);
+            fs::create_symlink("/dev/i2c-" + std::to_string(bus++),
+                               muxDir / name);
+            names.push_back(name);
+        }
+    }
+
+    const double walk = measure(names, lookups, [&dir](const std::string& n) {
+        return walkLookup(dir, n);
+    });
+    common::ChannelIndex index(dir);
+    const double indexed =
+        measure(names, lookups,
+                [&index](const std::string& n) { return index.lookup(n); });
+
+    printf("%d muxes x %d channels, %zu lookups\n", muxes, channels, lookups);
+    printf("directory walk: %10.0f ns per lookup\n", walk);
+    printf("indexed:        %10.0f ns per lookup\n", indexed);
+
+    std::error_code ec;
+    fs::remove_all(dir, ec);
+    return EXIT_SUCCESS;
+}
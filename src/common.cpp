@@ -5,11 +5,13 @@
 
 #include "common.hpp"
 
+#include "common/channel_index.hpp"
 #include "dbus.hpp"
 
 #include <phosphor-logging/log.hpp>
 #include <xyz/openbmc_project/State/Host/server.hpp>
 
+#include <cstring>
 #include <filesystem>
 
 using Host = sdbusplus::xyz::openbmc_project::State::server::Host;
@@ -85,6 +87,8 @@ void PowerState::hostStateChanged(sdbusplus::message::message& msg)
     auto hostStateProp = properties.find(dbus::power::properties::state);
     if (hostStateProp != properties.end())
     {
+        // The signal is newer than the pending Get reply, if any
+        hostStateCall.reset();
         auto currentHostState = Host::convertHostStateFromString(
             std::get<std::string>(hostStateProp->second));
         const bool powerState = hostStateToBool(currentHostState);
@@ -94,75 +98,42 @@ void PowerState::hostStateChanged(sdbusplus::message::message& msg)
 
 void PowerState::readHostState()
 {
-    DbusPropVariant data;
     auto getProperty =
         bus.new_method_call(dbus::power::busname, dbus::power::path,
                             dbus::properties::interface, dbus::properties::get);
     getProperty.append(dbus::power::interface, dbus::power::properties::state);
 
-    try
-    {
-        log<level::DEBUG>("Calling Get for Host State object");
-        bus.call(getProperty).read(data);
-        log<level::DEBUG>("Get call done");
-    }
-    catch (const sdbusplus::exception::exception& ex)
-    {
-        log<level::ERR>("Error while calling Get",
-                        entry("SERVICE=%s", dbus::power::busname),
-                        entry("PATH=%s", dbus::power::path),
-                        entry("INTERFACE=%s", dbus::pid::interface),
-                        entry("WHAT=%s", ex.description()));
-        return;
-    }
+    log<level::DEBUG>("Calling Get for Host State object");
+    hostStateCall = std::make_unique<common::AsyncCall>(
+        bus, getProperty, [this](sdbusplus::message::message& reply) {
+            hostStateCall.reset();
+            if (common::AsyncCall::isError(reply))
+            {
+                log<level::ERR>(
+                    "Error while calling Get",
+                    entry("SERVICE=%s", dbus::power::busname),
+                    entry("PATH=%s", dbus::power::path),
+                    entry("INTERFACE=%s", dbus::pid::interface),
+                    entry("WHAT=%s",
+                          common::AsyncCall::errorMessage(reply).c_str()));
+                return;
+            }
 
-    auto currentHostState =
-        Host::convertHostStateFromString(std::get<std::string>(data));
-    const bool powerState = hostStateToBool(currentHostState);
-    setPowerState(powerState);
+            DbusPropVariant data;
+            reply.read(data);
+            log<level::DEBUG>("Get call done");
+            auto currentHostState =
+                Host::convertHostStateFromString(std::get<std::string>(data));
+            setPowerState(hostStateToBool(currentHostState));
+        });
 }
 
 static constexpr const char* muxSymlinkDirPath = "/dev/i2c-mux";
-static constexpr int symlinkDepth = 1;
 
 std::string getBusByChanName(const std::string& chanName)
 {
-    fs::path muxSymlinkDir(muxSymlinkDirPath);
-    std::error_code ec;
-    if (!fs::exists(muxSymlinkDir, ec))
-    {
-        log<level::ERR>("I2C mux directory does not exists",
-                        entry("PATH=%s", muxSymlinkDirPath),
-                        entry("ERROR=%s", ec.message().c_str()));
-        return std::string();
-    }
-
-    std::string busDevice;
-    for (auto p = fs::recursive_directory_iterator(
-             muxSymlinkDir, fs::directory_options::follow_directory_symlink);
-         p != fs::recursive_directory_iterator(); ++p)
-    {
-        fs::path path = p->path();
-        if (!is_directory(*p))
-        {
-            if (path.filename() == chanName)
-            {
-                const std::string busFile = fs::read_symlink(*p, ec);
-                if (ec)
-                {
-                    log<level::ERR>("Can't read link destination",
-                                    entry("PATH=%s", path.c_str()),
-                                    entry("ERROR=%s", ec.message().c_str()));
-                }
-                return busFile;
-            }
-        }
-        if (p.depth() >= symlinkDepth)
-        {
-            p.disable_recursion_pending();
-        }
-    }
-    return std::string();
+    static common::ChannelIndex index(muxSymlinkDirPath);
+    return index.lookup(chanName);
 }
 
 void rtrim(std::string& str, const std::string& chars)
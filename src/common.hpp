@@ -5,11 +5,14 @@
 
 #pragma once
 
+#include "common/async_call.hpp"
+
 #include <sdbusplus/bus.hpp>
 #include <sdbusplus/bus/match.hpp>
 
 #include <functional>
 #include <map>
+#include <memory>
 #include <string>
 
 /**
@@ -120,6 +123,9 @@ class PowerState
 
     /** @brief The propertiesChanged match */
     std::optional<sdbusplus::bus::match::match> match;
+
+    /** @brief Pending CurrentHostState request */
+    std::unique_ptr<common::AsyncCall> hostStateCall;
 };
 
 /**
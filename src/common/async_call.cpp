@@ -0,0 +1,168 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (C) 2022, KNS Group LLC (YADRO).
+ */
+
+#include "common/async_call.hpp"
+
+#include <phosphor-logging/log.hpp>
+
+using namespace phosphor::logging;
+
+namespace common
+{
+
+/**
+ * @brief Run the reply handler, the exceptions must not reach sd-bus
+ */
+static void runHandler(const AsyncCall::Handler& handler,
+                       sdbusplus::message::message& reply)
+{
+    try
+    {
+        handler(reply);
+    }
+    catch (const std::exception& e)
+    {
+        log<level::ERR>("Failed to handle D-Bus reply",
+                        entry("REASON=%s", e.what()));
+    }
+}
+
+AsyncCall::AsyncCall(sdbusplus::bus::bus& bus,
+                     sdbusplus::message::message& msg, Handler handler,
+                     uint64_t timeout) :
+    handler(std::move(handler))
+{
+    const int rc = sd_bus_call_async(bus.get(), &slot, msg.get(),
+                                     &AsyncCall::dispatch, this, timeout);
+    if (rc < 0)
+    {
+        slot = nullptr;
+        throw sdbusplus::exception::SdBusError(-rc, "sd_bus_call_async");
+    }
+}
+
+AsyncCall::~AsyncCall()
+{
+    cancel();
+}
+
+void AsyncCall::cancel()
+{
+    // releasing the slot of the pending call cancels it
+    slot = sd_bus_slot_unref(slot);
+}
+
+bool AsyncCall::isError(sdbusplus::message::message& reply)
+{
+    return sd_bus_message_is_method_error(reply.get(), nullptr) > 0;
+}
+
+std::string AsyncCall::errorMessage(sdbusplus::message::message& reply)
+{
+    const sd_bus_error* error = sd_bus_message_get_error(reply.get());
+    if (!error)
+    {
+        return std::string();
+    }
+    return error->message ? error->message
+                          : (error->name ? error->name : std::string());
+}
+
+int AsyncCall::dispatch(sd_bus_message* reply, void* userdata, sd_bus_error*)
+{
+    auto call = static_cast<AsyncCall*>(userdata);
+    // sd-bus keeps the slot referenced while the reply is dispatched
+    call->slot = sd_bus_slot_unref(call->slot);
+    // the handler may destroy the call object, so it must be the last action
+    const Handler handler = std::move(call->handler);
+    sdbusplus::message::message msg(reply);
+    runHandler(handler, msg);
+    return 0;
+}
+
+/**
+ * @brief Reply handler of the detached call
+ */
+static int dispatchDetached(sd_bus_message* reply, void* userdata,
+                            sd_bus_error*)
+{
+    std::unique_ptr<AsyncCall::Handler> handler(
+        static_cast<AsyncCall::Handler*>(userdata));
+    if (*handler)
+    {
+        sdbusplus::message::message msg(reply);
+        runHandler(*handler, msg);
+    }
+    return 0;
+}
+
+void callDetached(sdbusplus::bus::bus& bus, sdbusplus::message::message& msg,
+                  AsyncCall::Handler handler, uint64_t timeout)
+{
+    auto data = std::make_unique<AsyncCall::Handler>(std::move(handler));
+    // the floating slot is owned by the bus
+    const int rc = sd_bus_call_async(bus.get(), nullptr, msg.get(),
+                                     dispatchDetached, data.get(), timeout);
+    if (rc < 0)
+    {
+        throw sdbusplus::exception::SdBusError(-rc, "sd_bus_call_async");
+    }
+    data.release();
+}
+
+void AsyncCallGroup::call(sdbusplus::message::message& msg,
+                          AsyncCall::Handler handler)
+{
+    if (!pending)
+    {
+        // drop the calls of the previous batch, they are all completed
+        calls.clear();
+    }
+    calls.emplace_back(std::make_unique<AsyncCall>(
+        bus, msg,
+        [this, handler = std::move(handler),
+         gen = generation](sdbusplus::message::message& reply) {
+            runHandler(handler, reply);
+            if (gen == generation)
+            {
+                completed();
+            }
+        },
+        timeout));
+    ++pending;
+}
+
+void AsyncCallGroup::join(JoinHandler handler)
+{
+    if (pending)
+    {
+        joinHandler = std::move(handler);
+    }
+    else if (handler)
+    {
+        handler();
+    }
+}
+
+void AsyncCallGroup::cancel()
+{
+    joinHandler = nullptr;
+    pending = 0;
+    ++generation;
+    calls.clear();
+}
+
+void AsyncCallGroup::completed()
+{
+    if (--pending == 0 && joinHandler)
+    {
+        // the handler may start the next batch or destroy the group
+        const JoinHandler handler = std::move(joinHandler);
+        joinHandler = nullptr;
+        handler();
+    }
+}
+
+} // namespace common
@@ -0,0 +1,173 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (C) 2022, KNS Group LLC (YADRO).
+ */
+#pragma once
+
+#include <systemd/sd-bus.h>
+
+#include <sdbusplus/bus.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace common
+{
+
+/**
+ * @brief Asynchronous D-Bus method call
+ *
+ * The reply is dispatched by the loop processing the bus (sd-event or asio),
+ * so the caller is not blocked while the peer is busy. Destroying the object
+ * cancels the call, the handler is not called in this case.
+ */
+class AsyncCall
+{
+  public:
+    /**
+     * @brief Reply handler
+     *
+     * Failures and timeouts are delivered as error replies, see isError().
+     * The handler may destroy the call object.
+     */
+    using Handler = std::function<void(sdbusplus::message::message&)>;
+
+    AsyncCall(const AsyncCall&) = delete;
+    AsyncCall& operator=(const AsyncCall&) = delete;
+    AsyncCall(AsyncCall&&) = delete;
+    AsyncCall& operator=(AsyncCall&&) = delete;
+
+    /**
+     * @brief Constructor, sends the method call
+     *
+     * @param[in] bus - D-Bus connection
+     * @param[in] msg - method call message
+     * @param[in] handler - reply handler
+     * @param[in] timeout - reply timeout in microseconds, zero for the
+     *                      default one
+     * @throw sdbusplus::exception::SdBusError if the call can't be sent
+     */
+    AsyncCall(sdbusplus::bus::bus& bus, sdbusplus::message::message& msg,
+              Handler handler, uint64_t timeout = 0);
+
+    ~AsyncCall();
+
+    /**
+     * @brief Cancel the call if it is still pending
+     */
+    void cancel();
+
+    /**
+     * @brief Check if the reply has not been received yet
+     */
+    bool isPending() const
+    {
+        return slot != nullptr;
+    }
+
+    /**
+     * @brief Check if the reply reports an error (including timeout)
+     */
+    static bool isError(sdbusplus::message::message& reply);
+
+    /**
+     * @brief Get the error description of the error reply
+     */
+    static std::string errorMessage(sdbusplus::message::message& reply);
+
+  private:
+    static int dispatch(sd_bus_message* reply, void* userdata, sd_bus_error*);
+
+    Handler handler;
+    sd_bus_slot* slot = nullptr;
+};
+
+/**
+ * @brief Send the method call not bound to any owner
+ *
+ * The call can't be cancelled, so the handler must not refer to objects which
+ * may be destroyed before the reply comes.
+ *
+ * @param[in] bus - D-Bus connection
+ * @param[in] msg - method call message
+ * @param[in] handler - reply handler, may be empty
+ * @param[in] timeout - reply timeout in microseconds, zero for the default one
+ * @throw sdbusplus::exception::SdBusError if the call can't be sent
+ */
+void callDetached(sdbusplus::bus::bus& bus, sdbusplus::message::message& msg,
+                  AsyncCall::Handler handler = nullptr, uint64_t timeout = 0);
+
+/**
+ * @brief Group of asynchronous calls sent together
+ *
+ * The join handler is called once all the calls of the group are completed.
+ * Cancelling the group cancels all the pending calls and the join handler.
+ */
+class AsyncCallGroup
+{
+  public:
+    /** @brief Handler called when all the calls are completed */
+    using JoinHandler = std::function<void()>;
+
+    AsyncCallGroup(const AsyncCallGroup&) = delete;
+    AsyncCallGroup& operator=(const AsyncCallGroup&) = delete;
+    AsyncCallGroup(AsyncCallGroup&&) = delete;
+    AsyncCallGroup& operator=(AsyncCallGroup&&) = delete;
+
+    /**
+     * @brief Constructor
+     *
+     * @param[in] bus - D-Bus connection
+     * @param[in] timeout - reply timeout of every call in microseconds, zero
+     *                      for the default one
+     */
+    AsyncCallGroup(sdbusplus::bus::bus& bus, uint64_t timeout = 0) :
+        bus(bus), timeout(timeout)
+    {}
+
+    /**
+     * @brief Send the method call as a part of the group
+     *
+     * @param[in] msg - method call message
+     * @param[in] handler - reply handler, it may cancel the group, but must
+     *                      not destroy it
+     * @throw sdbusplus::exception::SdBusError if the call can't be sent
+     */
+    void call(sdbusplus::message::message& msg, AsyncCall::Handler handler);
+
+    /**
+     * @brief Set the handler to be called when all the calls are completed
+     *
+     * The handler is called immediately if there are no pending calls.
+     */
+    void join(JoinHandler handler);
+
+    /**
+     * @brief Cancel all the pending calls and the join handler
+     */
+    void cancel();
+
+    /**
+     * @brief Check if some calls of the group are still pending
+     */
+    bool isPending() const
+    {
+        return pending != 0;
+    }
+
+  private:
+    void completed();
+
+    sdbusplus::bus::bus& bus;
+    uint64_t timeout;
+    std::vector<std::unique_ptr<AsyncCall>> calls;
+    size_t pending = 0;
+    /* Incremented on cancel to ignore the replies already dispatched */
+    unsigned generation = 0;
+    JoinHandler joinHandler;
+};
+
+} // namespace common
@@ -0,0 +1,146 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (C) 2022, KNS Group LLC (YADRO).
+ */
+
+#include "common/channel_index.hpp"
+
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <phosphor-logging/log.hpp>
+
+#include <cstring>
+
+using namespace phosphor::logging;
+namespace fs = std::filesystem;
+
+namespace common
+{
+
+static constexpr int symlinkDepth = 1;
+
+ChannelIndex::ChannelIndex(fs::path dir) : dir(std::move(dir))
+{
+    inotifyFD = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFD < 0)
+    {
+        log<level::ERR>("Failed to initialize inotify",
+                        entry("ERROR=%s", std::strerror(errno)));
+    }
+}
+
+ChannelIndex::~ChannelIndex()
+{
+    if (inotifyFD >= 0)
+    {
+        close(inotifyFD);
+    }
+}
+
+std::string ChannelIndex::lookup(const std::string& chanName)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (changed())
+    {
+        rebuild();
+    }
+    const auto it = buses.find(chanName);
+    return it != buses.end() ? it->second : std::string();
+}
+
+/**
+ * @brief Drain pending inotify events
+ *
+ * @return true if the index has to be rebuilt
+ */
+bool ChannelIndex::changed()
+{
+    if (inotifyFD < 0)
+    {
+        return true;
+    }
+    alignas(inotify_event) char buf[4096];
+    ssize_t len;
+    while ((len = read(inotifyFD, buf, sizeof(buf))) > 0)
+    {
+        valid = false;
+    }
+    return !valid;
+}
+
+void ChannelIndex::rebuild()
+{
+    buses.clear();
+
+    std::error_code ec;
+    if (!fs::exists(dir, ec))
+    {
+        log<level::ERR>("I2C mux directory does not exists",
+                        entry("PATH=%s", dir.c_str()),
+                        entry("ERROR=%s", ec.message().c_str()));
+        return;
+    }
+    // the directory is watched before the enumeration, so the changes
+    // made during the enumeration are not missed
+    valid = watch(dir);
+
+    for (auto p = fs::recursive_directory_iterator(
+             dir, fs::directory_options::follow_directory_symlink, ec);
+         p != fs::recursive_directory_iterator(); p.increment(ec))
+    {
+        if (ec)
+        {
+            break;
+        }
+        fs::path path = p->path();
+        if (is_directory(*p))
+        {
+            valid = watch(path) && valid;
+        }
+        else
+        {
+            std::error_code linkEC;
+            const std::string busFile = fs::read_symlink(*p, linkEC);
+            if (linkEC)
+            {
+                log<level::ERR>("Can't read link destination",
+                                entry("PATH=%s", path.c_str()),
+                                entry("ERROR=%s", linkEC.message().c_str()));
+            }
+            // the first found link wins, like the directory walk did
+            buses.emplace(path.filename().string(), busFile);
+        }
+        if (p.depth() >= symlinkDepth)
+        {
+            p.disable_recursion_pending();
+        }
+    }
+    if (ec)
+    {
+        log<level::ERR>("Failed to enumerate I2C mux channels",
+                        entry("PATH=%s", dir.c_str()),
+                        entry("ERROR=%s", ec.message().c_str()));
+        valid = false;
+    }
+}
+
+bool ChannelIndex::watch(const fs::path& dir)
+{
+    if (inotifyFD < 0)
+    {
+        return false;
+    }
+    constexpr uint32_t mask = IN_CREATE | IN_DELETE | IN_MOVED_FROM |
+                              IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF;
+    if (inotify_add_watch(inotifyFD, dir.c_str(), mask) < 0)
+    {
+        log<level::ERR>("Failed to watch I2C mux directory",
+                        entry("PATH=%s", dir.c_str()),
+                        entry("ERROR=%s", std::strerror(errno)));
+        return false;
+    }
+    return true;
+}
+
+} // namespace common
@@ -0,0 +1,56 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (C) 2022, KNS Group LLC (YADRO).
+ */
+#pragma once
+
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace common
+{
+
+/**
+ * @brief Index of I2C mux channel names
+ *
+ * The index is built on the first lookup and is rebuilt only when the mux
+ * symlinks directory is changed. The changes are detected by inotify: pending
+ * events are drained (without blocking) before each lookup.
+ */
+class ChannelIndex
+{
+  public:
+    ChannelIndex(const ChannelIndex&) = delete;
+    ChannelIndex& operator=(const ChannelIndex&) = delete;
+
+    /**
+     * @brief Constructor
+     *
+     * @param[in] dir - directory of the mux symlinks (e.g. "/dev/i2c-mux")
+     */
+    explicit ChannelIndex(std::filesystem::path dir);
+    ~ChannelIndex();
+
+    /**
+     * @brief Lookup I2C bus device file by the channel name
+     *
+     * @param[in] chanName - name of the channel to lookup
+     * @return device file name, empty string if the channel is not found
+     */
+    std::string lookup(const std::string& chanName);
+
+  private:
+    bool changed();
+    void rebuild();
+    bool watch(const std::filesystem::path& dir);
+
+    std::filesystem::path dir;
+    int inotifyFD;
+    bool valid = false;
+    std::unordered_map<std::string, std::string> buses;
+    std::mutex mutex;
+};
+
+} // namespace common
@@ -0,0 +1,76 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (C) 2022, KNS Group LLC (YADRO).
+ */
+
+#include "common/file_watcher.hpp"
+
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <stdexcept>
+
+namespace common
+{
+
+FileWatcher::FileWatcher(const sdeventplus::Event& event,
+                         std::filesystem::path file, Handler handler,
+                         std::chrono::milliseconds debounce) :
+    file(std::move(file)),
+    handler(std::move(handler)), debounce(debounce),
+    timer(event, [this](auto&) { this->handler(); })
+{
+    inotifyFD = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFD < 0)
+    {
+        throw std::runtime_error(std::string("Failed to initialize inotify: ") +
+                                 std::strerror(errno));
+    }
+    const std::string dir = this->file.parent_path().string();
+    if (inotify_add_watch(inotifyFD, dir.c_str(),
+                          IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM |
+                              IN_DELETE) < 0)
+    {
+        const int err = errno;
+        close(inotifyFD);
+        throw std::runtime_error("Failed to watch " + dir + ": " +
+                                 std::strerror(err));
+    }
+    eventSource.emplace(event, inotifyFD, EPOLLIN,
+                        [this](sdeventplus::source::IO&, int, uint32_t) {
+                            processEvents();
+                        });
+}
+
+FileWatcher::~FileWatcher()
+{
+    eventSource.reset();
+    close(inotifyFD);
+}
+
+void FileWatcher::processEvents()
+{
+    alignas(inotify_event) char buf[4096];
+    ssize_t len;
+    bool changed = false;
+    while ((len = read(inotifyFD, buf, sizeof(buf))) > 0)
+    {
+        for (char* ptr = buf; ptr < buf + len;)
+        {
+            const auto* event = reinterpret_cast<const inotify_event*>(ptr);
+            if ((event->mask & IN_Q_OVERFLOW) ||
+                (event->len && file.filename() == event->name))
+            {
+                changed = true;
+            }
+            ptr += sizeof(inotify_event) + event->len;
+        }
+    }
+    if (changed)
+    {
+        timer.restartOnce(debounce);
+    }
+}
+
+} // namespace common
@@ -0,0 +1,68 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (C) 2022, KNS Group LLC (YADRO).
+ */
+#pragma once
+
+#include <sdeventplus/clock.hpp>
+#include <sdeventplus/event.hpp>
+#include <sdeventplus/source/io.hpp>
+#include <sdeventplus/utility/timer.hpp>
+
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <optional>
+#include <string>
+
+namespace common
+{
+
+/**
+ * @brief Watcher of a file modifications
+ *
+ * The file directory is watched with inotify, so the file may be created,
+ * rewritten, replaced (e.g. atomically renamed) or removed after the watcher
+ * started. Bursts of modifications are debounced: the handler is called once
+ * when the file has not been changed during the debounce time.
+ */
+class FileWatcher
+{
+  public:
+    /** @brief Handler to be called when the file is changed */
+    using Handler = std::function<void()>;
+
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+    FileWatcher(FileWatcher&&) = delete;
+    FileWatcher& operator=(FileWatcher&&) = delete;
+
+    /**
+     * @brief Constructor, starts watching
+     *
+     * @param[in] event - event loop
+     * @param[in] file - path of the file to watch
+     * @param[in] handler - file change handler
+     * @param[in] debounce - time to wait for the next modification
+     * @throw std::runtime_error if the directory can't be watched
+     */
+    FileWatcher(const sdeventplus::Event& event, std::filesystem::path file,
+                Handler handler,
+                std::chrono::milliseconds debounce = defaultDebounce);
+
+    ~FileWatcher();
+
+    static constexpr std::chrono::milliseconds defaultDebounce{500};
+
+  private:
+    void processEvents();
+
+    std::filesystem::path file;
+    Handler handler;
+    std::chrono::milliseconds debounce;
+    int inotifyFD;
+    std::optional<sdeventplus::source::IO> eventSource;
+    sdeventplus::utility::Timer<sdeventplus::ClockId::Monotonic> timer;
+};
+
+} // namespace common
@@ -0,0 +1,185 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (C) 2022, KNS Group LLC (YADRO).
+ */
+
+#include "common/mapper_cache.hpp"
+
+#include <phosphor-logging/log.hpp>
+
+using namespace phosphor::logging;
+namespace sdbusRule = sdbusplus::bus::match::rules;
+
+namespace common
+{
+
+MapperCache::MapperCache(sdbusplus::bus::bus& bus, uint64_t timeout) :
+    bus(bus), timeout(timeout)
+{
+    const auto objectHandler = [this](sdbusplus::message::message& msg) {
+        objectChanged(msg);
+    };
+    matches.emplace_back(std::make_unique<sdbusplus::bus::match::match>(
+        bus, sdbusRule::interfacesAdded(), objectHandler));
+    matches.emplace_back(std::make_unique<sdbusplus::bus::match::match>(
+        bus, sdbusRule::interfacesRemoved(), objectHandler));
+    matches.emplace_back(std::make_unique<sdbusplus::bus::match::match>(
+        bus, sdbusRule::nameOwnerChanged(),
+        [this](sdbusplus::message::message& msg) { ownerChanged(msg); }));
+}
+
+void MapperCache::getSubTree(const std::string& path, int32_t depth,
+                             const Interfaces& interfaces,
+                             SubTreeHandler handler)
+{
+    SubTreeKey key(path, depth, interfaces);
+    const auto it = subtrees.find(key);
+    if (it != subtrees.end())
+    {
+        handler(it->second);
+        return;
+    }
+
+    lookups.remove_if([](const auto& call) { return !call->isPending(); });
+
+    auto getObjects =
+        bus.new_method_call(dbus::mapper::busName, dbus::mapper::path,
+                            dbus::mapper::interface, dbus::mapper::subtree);
+    getObjects.append(path, depth, interfaces);
+    log<level::DEBUG>("Calling GetSubTree", entry("PATH=%s", path.c_str()));
+    try
+    {
+        lookups.emplace_back(std::make_unique<AsyncCall>(
+            bus, getObjects,
+            [this, key = std::move(key), handler, gen = generation](
+                sdbusplus::message::message& reply) {
+                if (AsyncCall::isError(reply))
+                {
+                    log<level::ERR>(
+                        "Error while calling GetSubTree",
+                        entry("PATH=%s", std::get<0>(key).c_str()),
+                        entry("WHAT=%s",
+                              AsyncCall::errorMessage(reply).c_str()));
+                    handler(std::nullopt);
+                    return;
+                }
+                SubTreeType objects;
+                reply.read(objects);
+                log<level::DEBUG>("GetSubTree call done");
+                if (gen == generation)
+                {
+                    subtrees[key] = objects;
+                }
+                handler(objects);
+            },
+            timeout));
+    }
+    catch (const sdbusplus::exception::exception& ex)
+    {
+        log<level::ERR>("Error while calling GetSubTree",
+                        entry("PATH=%s", path.c_str()),
+                        entry("WHAT=%s", ex.what()));
+        handler(std::nullopt);
+    }
+}
+
+void MapperCache::clear()
+{
+    ++generation;
+    subtrees.clear();
+}
+
+/**
+ * @brief InterfacesAdded/InterfacesRemoved handler, drops the subtrees
+ *        containing the object
+ */
+void MapperCache::objectChanged(sdbusplus::message::message& msg)
+{
+    sdbusplus::message::object_path object;
+    try
+    {
+        msg.read(object);
+    }
+    catch (const sdbusplus::exception::exception&)
+    {
+        clear();
+        return;
+    }
+
+    ++generation;
+    const std::string& objPath = object.str;
+    for (auto it = subtrees.begin(); it != subtrees.end();)
+    {
+        const std::string& root = std::get<0>(it->first);
+        const bool inside =
+            root == "/" ||
+            (objPath.compare(0, root.size(), root) == 0 &&
+             (objPath.size() == root.size() || objPath[root.size()] == '/'));
+        if (inside)
+        {
+            it = subtrees.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+/**
+ * @brief NameOwnerChanged handler, drops the subtrees if a service appeared
+ *        or disappeared
+ *
+ * The mapper reports well-known names if available, so any change of them
+ * drops all the subtrees, while the unique names matter only if they leave.
+ */
+void MapperCache::ownerChanged(sdbusplus::message::message& msg)
+{
+    std::string name;
+    std::string oldOwner;
+    std::string newOwner;
+    try
+    {
+        msg.read(name, oldOwner, newOwner);
+    }
+    catch (const sdbusplus::exception::exception&)
+    {
+        clear();
+        return;
+    }
+
+    if (name.empty() || name[0] != ':')
+    {
+        clear();
+        return;
+    }
+    if (!newOwner.empty())
+    {
+        // a new connection doesn't own the objects known to the mapper yet
+        return;
+    }
+    // the connection has left the bus, drop only the subtrees it owned
+    ++generation;
+    for (auto it = subtrees.begin(); it != subtrees.end();)
+    {
+        bool owned = false;
+        for (const auto& [_, owners] : it->second)
+        {
+            if (owners.find(name) != owners.end())
+            {
+                owned = true;
+                break;
+            }
+        }
+        if (owned)
+        {
+            it = subtrees.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+} // namespace common
@@ -0,0 +1,88 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (C) 2022, KNS Group LLC (YADRO).
+ */
+#pragma once
+
+#include "common/async_call.hpp"
+#include "dbus.hpp"
+
+#include <sdbusplus/bus.hpp>
+#include <sdbusplus/bus/match.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace common
+{
+
+/**
+ * @brief ObjectMapper client caching the subtree lookups
+ *
+ * The cached results are dropped when the objects under the looked up path
+ * are added or removed, or when a service appears or disappears on the bus,
+ * so the repeated lookups don't require D-Bus calls. The mapper is called
+ * asynchronously.
+ */
+class MapperCache
+{
+  public:
+    /** @brief Subtree lookup handler, receives nothing on failure */
+    using SubTreeHandler =
+        std::function<void(const std::optional<SubTreeType>&)>;
+
+    MapperCache(const MapperCache&) = delete;
+    MapperCache& operator=(const MapperCache&) = delete;
+    MapperCache(MapperCache&&) = delete;
+    MapperCache& operator=(MapperCache&&) = delete;
+
+    /**
+     * @brief Constructor, starts tracking the bus changes
+     *
+     * @param[in] bus - D-Bus connection
+     * @param[in] timeout - mapper call timeout in microseconds, zero for the
+     *                      default one
+     */
+    MapperCache(sdbusplus::bus::bus& bus, uint64_t timeout = 0);
+
+    /**
+     * @brief Get objects implementing the interfaces (mapper GetSubTree)
+     *
+     * @param[in] path - subtree root path
+     * @param[in] depth - max depth of the subtree, zero for unlimited
+     * @param[in] interfaces - interfaces to filter the objects by
+     * @param[in] handler - lookup handler, it is called immediately if the
+     *                      result is cached
+     */
+    void getSubTree(const std::string& path, int32_t depth,
+                    const Interfaces& interfaces, SubTreeHandler handler);
+
+    /**
+     * @brief Drop all the cached results
+     */
+    void clear();
+
+  private:
+    void objectChanged(sdbusplus::message::message& msg);
+    void ownerChanged(sdbusplus::message::message& msg);
+
+    using SubTreeKey = std::tuple<std::string, int32_t, Interfaces>;
+
+    sdbusplus::bus::bus& bus;
+    uint64_t timeout;
+    std::map<SubTreeKey, SubTreeType> subtrees;
+    /* Incremented on every invalidation, the results of the lookups sent
+     * before are not cached */
+    unsigned generation = 0;
+    std::list<std::unique_ptr<AsyncCall>> lookups;
+    std::vector<std::unique_ptr<sdbusplus::bus::match::match>> matches;
+};
+
+} // namespace common
@@ -10,13 +10,30 @@
 #include <unistd.h>
 
 #include <system_error>
+#include <utility>
 
 namespace common
 {
 
+MappedMem::MappedMem(MappedMem&& other) noexcept :
+    addr(std::exchange(other.addr, nullptr)),
+    length(std::exchange(other.length, 0))
+{}
+
+MappedMem& MappedMem::operator=(MappedMem&& other) noexcept
+{
+    // the previous mapping is released by the moved-from object
+    std::swap(addr, other.addr);
+    std::swap(length, other.length);
+    return *this;
+}
+
 MappedMem::~MappedMem()
 {
-    munmap(addr, length);
+    if (addr)
+    {
+        munmap(addr, length);
+    }
 }
 
 MappedMem MappedMem::open(const std::string& filePath)
@@ -36,7 +53,8 @@ MappedMem MappedMem::open(const std::string& filePath)
                                 "lseek failed");
     }
 
-    auto addr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    auto addr =
+        mmap(nullptr, size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
     auto mmapErrNo = errno;
     close(fd);
 
@@ -46,6 +64,9 @@ MappedMem MappedMem::open(const std::string& filePath)
                                 "mmap failed");
     }
 
+    // the hint is optional, so the failure is not an error
+    madvise(addr, size, MADV_SEQUENTIAL);
+
     return MappedMem(addr, size);
 }
 
@@ -18,8 +18,8 @@ struct MappedMem
     MappedMem() = delete;
     MappedMem(const MappedMem&) = delete;
     MappedMem& operator=(const MappedMem&) = delete;
-    MappedMem(MappedMem&&) = default;
-    MappedMem& operator=(MappedMem&&) = default;
+    MappedMem(MappedMem&& other) noexcept;
+    MappedMem& operator=(MappedMem&& other) noexcept;
 
     virtual ~MappedMem();
 
@@ -39,6 +39,9 @@ struct MappedMem
     /**
      * @brief Map specified file into memory
      *
+     * The file is mapped read-only, populated at once and advised for
+     * sequential access.
+     *
      * @param filePath - path to file
      *
      * @return MappedMem object with file content.
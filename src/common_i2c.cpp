@@ -16,6 +16,7 @@
 #include <iomanip>
 #include <iostream>
 #include <map>
+#include <mutex>
 #include <utility>
 
 using namespace phosphor::logging;
@@ -34,6 +35,9 @@ struct I2cContext
 using I2cContextKey = std::pair<std::string, int>;
 using I2cContextMap = std::map<I2cContextKey, I2cContext>;
 
+//  devices may be accessed from several worker threads (e.g. parallel reflash)
+static std::mutex i2cContextMutex;
+
 static I2cContext& getI2cContext(const i2cDev& dev)
 {
     static I2cContextMap contexts;
@@ -314,6 +318,7 @@ int i2cDev::i2c_transfer(uint8_t tx_len, uint8_t* tx_data, uint8_t rx_len,
 
 static bool isSpamingToLog(const i2cDev& dev, int res)
 {
+    std::lock_guard<std::mutex> lock(i2cContextMutex);
     I2cContext& context = getI2cContext(dev);
     auto& numLogErrors = context.numLogErrors;
 
@@ -48,6 +48,7 @@ auto SoftwareObject::activation(Activations value) -> Activations
             }
         }
 #endif
+        progress(0);
         fs::path firmwareDir(path());
         std::string imageFilename = extendedVersion() + ".bin";
         if (!target->updateImage(firmwareDir / imageFilename, version(),
@@ -71,5 +72,14 @@ auto SoftwareObject::requestedActivation(RequestedActivations value)
     {
         activation(softwareServer::Activation::Activations::Activating);
     }
+    else if ((value ==
+              softwareServer::Activation::RequestedActivations::None) &&
+             (softwareServer::Activation::activation() ==
+              softwareServer::Activation::Activations::Activating))
+    {
+        // Resetting the request during activation cancels the update, the
+        // activation fails once the target stops
+        target->cancelUpdate();
+    }
     return softwareServer::Activation::requestedActivation(value);
 }
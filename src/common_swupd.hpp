@@ -5,9 +5,12 @@
 
 #pragma once
 
+#include "com/yadro/Software/UpdateQueue/server.hpp"
+
 #include <xyz/openbmc_project/Association/Definitions/server.hpp>
 #include <xyz/openbmc_project/Common/FilePath/server.hpp>
 #include <xyz/openbmc_project/Software/Activation/server.hpp>
+#include <xyz/openbmc_project/Software/ActivationProgress/server.hpp>
 #include <xyz/openbmc_project/Software/ExtendedVersion/server.hpp>
 #include <xyz/openbmc_project/Software/Version/server.hpp>
 
@@ -16,10 +19,12 @@
 
 using ActivationServer = sdbusplus::server::object::object<
     sdbusplus::xyz::openbmc_project::Software::server::Activation,
+    sdbusplus::xyz::openbmc_project::Software::server::ActivationProgress,
     sdbusplus::xyz::openbmc_project::Software::server::ExtendedVersion,
     sdbusplus::xyz::openbmc_project::Software::server::Version,
     sdbusplus::xyz::openbmc_project::Common::server::FilePath,
-    sdbusplus::xyz::openbmc_project::Association::server::Definitions>;
+    sdbusplus::xyz::openbmc_project::Association::server::Definitions,
+    sdbusplus::com::yadro::Software::server::UpdateQueue>;
 
 class FirmwareUpdateble;
 
@@ -60,6 +65,26 @@ class SoftwareObject :
         return version();
     };
 
+    /** @brief Publish the activation progress
+     *
+     * @param[in] value - progress in percents
+     */
+    void updateProgress(uint8_t value)
+    {
+        progress(value);
+    }
+
+    /** @brief Publish the update queue state
+     *
+     * @param[in] position - number of updates to be done before this one
+     * @param[in] timeLeft - estimated time in seconds until completion
+     */
+    void updateQueueState(uint32_t position, uint64_t timeLeft)
+    {
+        queuePosition(position);
+        estimatedTime(timeLeft);
+    }
+
   private:
     std::shared_ptr<FirmwareUpdateble> target;
     std::string objectPath;
@@ -73,4 +98,5 @@ class FirmwareUpdateble
     virtual bool updateImage(std::filesystem::path imagePath,
                              std::string imageVersion, std::string dbusObject,
                              std::shared_ptr<SoftwareObject> updater) = 0;
+    virtual void cancelUpdate() = 0;
 };
@@ -76,6 +76,8 @@ constexpr const char* Present = "Present";
 
 namespace configuration
 {
+constexpr const char* busName = "xyz.openbmc_project.EntityManager";
+constexpr const char* path = "/";
 namespace bplmcu
 {
 constexpr const char* interface =
@@ -0,0 +1,748 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (C) 2022, KNS Group LLC (YADRO)
+ */
+
+#include "fru_inventory.hpp"
+
+#include "options.hpp"
+
+#include <strings.h>
+
+#include <phosphor-logging/log.hpp>
+
+#include <algorithm>
+#include <charconv>
+#include <optional>
+#include <regex>
+#include <string_view>
+
+using namespace phosphor::logging;
+namespace sdbusRule = sdbusplus::bus::match::rules;
+
+static constexpr uint64_t dbusTimeout = 1 * 1000 * 1000; // Set timeout to 1s
+
+/* Delay before the FRU devices are read again, seconds */
+static constexpr int reloadDelay = 1;
+/* Delay before a failed request is retried, seconds */
+static constexpr int retryDelay = 30;
+
+static constexpr const char* productName = "PRODUCT_PRODUCT_NAME";
+static constexpr const char* productPartNumber = "PRODUCT_PART_NUMBER";
+static constexpr const char* productSerialNumber = "PRODUCT_SERIAL_NUMBER";
+/* The options are stored in the FRU fields with this suffix */
+static constexpr const char* optionSuffix = "_INFO_AM";
+
+static bool isMotherboard(const std::string& path)
+{
+    return (path.rfind("Motherboard") != std::string::npos) ||
+           (path.rfind("Baseboard") != std::string::npos);
+}
+
+static bool isRiser(const std::string& path)
+{
+    return (path.rfind("Riser") != std::string::npos) ||
+           (path.rfind("Board") != std::string::npos);
+}
+
+/**
+ * @brief Get CPU index from the inventory object path (".../cpu<N>")
+ *
+ * @return CPU index, nothing if the object is not a CPU
+ */
+static std::optional<size_t> cpuIndex(const std::string& path)
+{
+    static constexpr const char* prefix = "cpu";
+    static constexpr size_t prefixLen = 3;
+    const size_t pos = path.rfind('/');
+    const std::string_view name = std::string_view(path).substr(
+        pos == std::string::npos ? 0 : pos + 1);
+    if (name.size() <= prefixLen ||
+        strncasecmp(name.data(), prefix, prefixLen) != 0)
+    {
+        return std::nullopt;
+    }
+    size_t index = 0;
+    const auto [end, ec] =
+        std::from_chars(name.data() + prefixLen, name.data() + name.size(),
+                        index);
+    if (ec != std::errc() || end != name.data() + name.size())
+    {
+        return std::nullopt;
+    }
+    return index;
+}
+
+static bool isOption(const std::string& property)
+{
+    return property.rfind(optionSuffix) != std::string::npos;
+}
+
+/**
+ * @brief Get type of the option stored in the FRU field
+ *
+ * @return option type, none if the field can't be an option
+ */
+static OptionType optionType(const DbusPropVariant& value)
+{
+    const std::string* option = std::get_if<std::string>(&value);
+    int type = 0;
+    if (option && option->size() >= 2)
+    {
+        std::from_chars(option->data(), option->data() + 2, type, 16);
+    }
+    return static_cast<OptionType>(type);
+}
+
+static void handleOption(HWManager* const manager, pcieCfg* const pcieConf,
+                         const std::string& option)
+{
+    OptionType optType = OptionType::none;
+    int instance = 0;
+    std::string value;
+    static const std::regex optionRegex(
+        "[a-f0-9]{4,}", std::regex::icase | std::regex::optimize);
+    if (!std::regex_match(option, optionRegex))
+    {
+        log<level::ERR>("Invalid option format",
+                        entry("VALUE=%s", option.c_str()));
+        return;
+    }
+
+    int type;
+    std::from_chars(option.data(), option.data() + 2, type, 16);
+    optType = static_cast<OptionType>(type);
+    std::from_chars(option.data() + 2, option.data() + 4, instance, 16);
+    value = option.substr(4);
+
+    switch (optType)
+    {
+        case OptionType::macAddr:
+            // do nothing
+            break;
+        case OptionType::cpuCooling:
+        case OptionType::chassisFans:
+        case OptionType::pidZoneMinSpeed:
+        {
+            if (!(manager && manager->setOption(optType, instance, value)))
+            {
+                log<level::ERR>("Can't handle option",
+                                entry("VALUE=%s", option.c_str()));
+            }
+            break;
+        }
+        case OptionType::pcieBifurcation:
+        {
+            if (!(pcieConf && pcieConf->addBifurcationConfig(instance, value)))
+            {
+                log<level::ERR>("Can't handle pcieBifurcation option",
+                                entry("VALUE=%s", option.c_str()));
+            }
+            break;
+        }
+        default:
+            log<level::ERR>("Unknown option type",
+                            entry("VALUE=%s", option.c_str()));
+            break;
+    }
+}
+
+FruInventory::FruInventory(
+    boost::asio::io_service& io,
+    std::shared_ptr<sdbusplus::asio::connection>& systemBus,
+    HWManager& manager) :
+    io(io),
+    systemBus(systemBus), manager(manager),
+    pcieConfiguration(static_cast<sdbusplus::bus::bus&>(*systemBus),
+                      manager.mapper),
+    loadTimer(io), cpuCalls(*systemBus, dbusTimeout), cpuTimer(io)
+{
+    auto& bus = static_cast<sdbusplus::bus::bus&>(*systemBus);
+    matches.emplace_back(std::make_unique<sdbusplus::bus::match::match>(
+        bus,
+        std::string(
+            "type='signal',member='PropertiesChanged',path_namespace='") +
+            dbus::fru::path + "',arg0namespace='" + dbus::fru::interface + "'",
+        [this](sdbusplus::message::message& msg) { fruChanged(msg); }));
+    matches.emplace_back(std::make_unique<sdbusplus::bus::match::match>(
+        bus,
+        sdbusRule::interfacesAdded() +
+            sdbusRule::argNpath(0, std::string(dbus::fru::path) + "/"),
+        [this](sdbusplus::message::message& msg) { fruAdded(msg); }));
+    matches.emplace_back(std::make_unique<sdbusplus::bus::match::match>(
+        bus,
+        sdbusRule::interfacesRemoved() +
+            sdbusRule::argNpath(0, std::string(dbus::fru::path) + "/"),
+        [this](sdbusplus::message::message& msg) { fruRemoved(msg); }));
+    matches.emplace_back(std::make_unique<sdbusplus::bus::match::match>(
+        bus,
+        std::string(
+            "type='signal',member='PropertiesChanged',path_namespace='") +
+            dbus::inventory::path + "',arg0namespace='" +
+            dbus::inventory::interface + "'",
+        [this](sdbusplus::message::message& msg) { cpuChanged(msg); }));
+    matches.emplace_back(std::make_unique<sdbusplus::bus::match::match>(
+        bus,
+        sdbusRule::interfacesAdded() +
+            sdbusRule::argNpath(0, std::string(dbus::inventory::path) + "/"),
+        [this](sdbusplus::message::message& msg) { cpuAdded(msg); }));
+    matches.emplace_back(std::make_unique<sdbusplus::bus::match::match>(
+        bus,
+        sdbusRule::interfacesRemoved() +
+            sdbusRule::argNpath(0, std::string(dbus::inventory::path) + "/"),
+        [this](sdbusplus::message::message& msg) { cpuRemoved(msg); }));
+}
+
+void FruInventory::load()
+{
+    auto getManagedObjects = systemBus->new_method_call(
+        dbus::fru::busName, "/", dbus::objmgr::interface,
+        dbus::objmgr::managedObjects);
+
+    log<level::DEBUG>("Calling GetManagedObjects for FruDevice");
+    loadStale = false;
+    try
+    {
+        // the request in progress (if any) is superseded
+        loadCall = std::make_unique<common::AsyncCall>(
+            *systemBus, getManagedObjects,
+            [this](sdbusplus::message::message& reply) {
+                loadCall.reset();
+                if (common::AsyncCall::isError(reply))
+                {
+                    log<level::DEBUG>(
+                        "Error while calling GetManagedObjects",
+                        entry("SERVICE=%s", dbus::fru::busName),
+                        entry("PATH=%s", "/"),
+                        entry("WHAT=%s",
+                              common::AsyncCall::errorMessage(reply).c_str()));
+                    loadDelayed(retryDelay);
+                    return;
+                }
+                ManagedObjectType managedObj;
+                reply.read(managedObj);
+                log<level::DEBUG>("GetManagedObjects call done");
+                loadCompleted(managedObj);
+            },
+            dbusTimeout);
+    }
+    catch (const sdbusplus::exception::exception& ex)
+    {
+        log<level::DEBUG>("Error while calling GetManagedObjects",
+                          entry("SERVICE=%s", dbus::fru::busName),
+                          entry("PATH=%s", "/"), entry("WHAT=%s", ex.what()));
+        loadDelayed(retryDelay);
+    }
+}
+
+void FruInventory::loadDelayed(int delay)
+{
+    // this implicitly cancels the timer
+    loadTimer.expires_from_now(boost::posix_time::seconds(delay));
+    loadTimer.async_wait([this](const boost::system::error_code& err) {
+        if (err == boost::asio::error::operation_aborted)
+        {
+            /* we were canceled*/
+            return;
+        }
+        else if (err)
+        {
+            log<level::ERR>("Timer error",
+                            entry("WHAT=%s", err.message().c_str()));
+            return;
+        }
+        load();
+    });
+}
+
+void FruInventory::loadCompleted(const ManagedObjectType& objects)
+{
+    fruObjects.clear();
+    for (const auto& [path, interfaces] : objects)
+    {
+        const auto it = interfaces.find(dbus::fru::interface);
+        if (it != interfaces.end())
+        {
+            fruObjects.emplace(path.str, it->second);
+        }
+    }
+    loaded = true;
+
+    updatePCIeConfig();
+    updateManagerConfig();
+    publish();
+
+    if (loadStale)
+    {
+        // the reply may be older than the signals received meanwhile
+        loadDelayed(reloadDelay);
+    }
+}
+
+/**
+ * @brief Check if the local copy can be updated by a signal
+ *
+ * The signals received while the FRU devices are being read may be older or
+ * newer than the reply, so the devices are read again in that case.
+ */
+bool FruInventory::isUpToDate()
+{
+    if (loadCall)
+    {
+        loadStale = true;
+        return false;
+    }
+    return loaded;
+}
+
+void FruInventory::fruChanged(sdbusplus::message::message& msg)
+{
+    if (!isUpToDate())
+    {
+        return;
+    }
+
+    Interface interface;
+    DbusProperties properties;
+    msg.read(interface, properties);
+    updateObject(msg.get_path(), properties);
+}
+
+void FruInventory::fruAdded(sdbusplus::message::message& msg)
+{
+    if (!isUpToDate())
+    {
+        return;
+    }
+
+    sdbusplus::message::object_path path;
+    std::map<Interface, DbusProperties> interfaces;
+    msg.read(path, interfaces);
+
+    const auto it = interfaces.find(dbus::fru::interface);
+    if (it != interfaces.end())
+    {
+        updateObject(path.str, it->second);
+    }
+}
+
+void FruInventory::fruRemoved(sdbusplus::message::message& msg)
+{
+    if (!isUpToDate())
+    {
+        return;
+    }
+
+    sdbusplus::message::object_path path;
+    std::vector<Interface> interfaces;
+    msg.read(path, interfaces);
+
+    if (std::find(interfaces.begin(), interfaces.end(),
+                  dbus::fru::interface) == interfaces.end() ||
+        !fruObjects.erase(path.str))
+    {
+        return;
+    }
+    if (isMotherboard(path.str))
+    {
+        updatePCIeConfig();
+        updateManagerConfig();
+        publish();
+    }
+    else if (isRiser(path.str))
+    {
+        updatePCIeConfig();
+    }
+}
+
+/**
+ * @brief Apply the changed FRU fields to the local copy
+ *
+ * Only the option groups the changed fields belong to are recomputed: the
+ * main board fields define the HW manager configuration, the PCIe bifurcation
+ * options may come from the main board as well as from the risers.
+ *
+ * @param[in] path - FRU device object path
+ * @param[in] changes - changed FruDevice properties
+ */
+void FruInventory::updateObject(const std::string& path,
+                                const DbusProperties& changes)
+{
+    const bool motherboard = isMotherboard(path);
+    const bool riser = !motherboard && isRiser(path);
+    bool managerChanged = false;
+    bool pcieChanged = false;
+
+    auto& properties = fruObjects[path];
+    for (const auto& [name, value] : changes)
+    {
+        auto it = properties.find(name);
+        if (it != properties.end() && it->second == value)
+        {
+            continue;
+        }
+        std::optional<DbusPropVariant> oldValue;
+        if (it != properties.end())
+        {
+            oldValue = it->second;
+        }
+        properties[name] = value;
+
+        if (isOption(name))
+        {
+            // the option may move from one group to another
+            for (const auto& option : {std::optional(value), oldValue})
+            {
+                if (!option)
+                {
+                    continue;
+                }
+                if (optionType(*option) == OptionType::pcieBifurcation)
+                {
+                    pcieChanged = pcieChanged || motherboard || riser;
+                }
+                else
+                {
+                    managerChanged = managerChanged || motherboard;
+                    pcieChanged = pcieChanged || riser;
+                }
+            }
+        }
+        else if (name == productName || name == productPartNumber ||
+                 name == productSerialNumber)
+        {
+            managerChanged = managerChanged || motherboard;
+        }
+    }
+
+    if (pcieChanged)
+    {
+        updatePCIeConfig();
+    }
+    if (managerChanged)
+    {
+        updateManagerConfig();
+        publish();
+    }
+}
+
+/**
+ * @brief Rebuild the HW manager configuration from the main board FRU
+ */
+void FruInventory::updateManagerConfig()
+{
+    manager.config.reset();
+
+    const auto motherboard =
+        std::find_if(fruObjects.begin(), fruObjects.end(),
+                     [](const auto& object) {
+                         return isMotherboard(object.first);
+                     });
+    if (motherboard != fruObjects.end())
+    {
+        for (const auto& [property, value] : motherboard->second)
+        {
+            try
+            {
+                if (property == productName)
+                {
+                    manager.setProduct(std::get<std::string>(value));
+                }
+                else if (property == productPartNumber)
+                {
+                    manager.config.chassisPartNumber =
+                        std::get<std::string>(value);
+                }
+                else if (property == productSerialNumber)
+                {
+                    manager.config.chassisSerial = std::get<std::string>(value);
+                }
+                else if (isOption(property) &&
+                         optionType(value) != OptionType::pcieBifurcation)
+                {
+                    handleOption(&manager, nullptr,
+                                 std::get<std::string>(value));
+                }
+            }
+            catch (std::exception const& ex)
+            {
+                log<level::ERR>("Error while reading FRU data",
+                                entry("WHAT=%s", ex.what()));
+            }
+        }
+    }
+
+    // CPU presence doesn't come from FRU, it is tracked separately
+    if (manager.config.haveCPUFans)
+    {
+        manager.config.cpuPresence = cpuPresence;
+    }
+}
+
+/**
+ * @brief Collect PCIe bifurcation options of all the boards and apply them
+ */
+void FruInventory::updatePCIeConfig()
+{
+    pcieConfiguration.clear();
+    bool motherboardFound = false;
+    for (const auto& [path, properties] : fruObjects)
+    {
+        const bool motherboard = isMotherboard(path);
+        if (motherboard)
+        {
+            // only the first main board is taken into account
+            if (motherboardFound)
+            {
+                continue;
+            }
+            motherboardFound = true;
+        }
+        else if (!isRiser(path))
+        {
+            continue;
+        }
+
+        for (const auto& [property, value] : properties)
+        {
+            try
+            {
+                if (isOption(property) &&
+                    (!motherboard ||
+                     optionType(value) == OptionType::pcieBifurcation))
+                {
+                    handleOption(nullptr, &pcieConfiguration,
+                                 std::get<std::string>(value));
+                }
+            }
+            catch (std::exception const& ex)
+            {
+                log<level::ERR>("Error while parsing FRU fields",
+                                entry("WHAT=%s", ex.what()));
+            }
+        }
+    }
+    pcieConfiguration.apply();
+}
+
+/**
+ * @brief Read presence of all the CPUs once, later it is tracked by signals
+ */
+void FruInventory::primeCPUPresence()
+{
+    cpuPresenceState = PrimeState::pending;
+    manager.mapper.getSubTree(
+        dbus::inventory::path, 0, {dbus::inventory::interface},
+        [this](const std::optional<SubTreeType>& objects) {
+            if (!objects)
+            {
+                primeCPUPresenceDelayed(retryDelay);
+                return;
+            }
+
+            auto failed = std::make_shared<bool>(false);
+            for (const auto& [path, objDict] : *objects)
+            {
+                const auto index = cpuIndex(path);
+                if (!index || objDict.empty())
+                {
+                    continue;
+                }
+
+                const std::string& owner = objDict.begin()->first;
+
+                auto getProperties = systemBus->new_method_call(
+                    owner.c_str(), path.c_str(), dbus::properties::interface,
+                    dbus::properties::getAll);
+                getProperties.append(dbus::inventory::interface);
+
+                log<level::DEBUG>("Calling GetAll for CPU object");
+                try
+                {
+                    cpuCalls.call(
+                        getProperties,
+                        [this, failed, owner, path = path,
+                         index = *index](sdbusplus::message::message& reply) {
+                            if (common::AsyncCall::isError(reply))
+                            {
+                                log<level::DEBUG>(
+                                    "Error while calling GetAll",
+                                    entry("SERVICE=%s", owner.c_str()),
+                                    entry("PATH=%s", path.c_str()),
+                                    entry("INTERFACE=%s",
+                                          dbus::inventory::interface),
+                                    entry("WHAT=%s",
+                                          common::AsyncCall::errorMessage(
+                                              reply)
+                                              .c_str()));
+                                *failed = true;
+                                return;
+                            }
+                            log<level::DEBUG>("GetAll call done");
+
+                            DbusProperties data;
+                            try
+                            {
+                                reply.read(data);
+                            }
+                            catch (const sdbusplus::exception::exception& ex)
+                            {
+                                log<level::ERR>(
+                                    "Error reading GetAll reply",
+                                    entry("PATH=%s", path.c_str()),
+                                    entry("WHAT=%s", ex.what()));
+                                *failed = true;
+                                return;
+                            }
+                            auto it =
+                                data.find(dbus::inventory::properties::Present);
+                            if (it == data.end() ||
+                                !std::holds_alternative<bool>(it->second))
+                            {
+                                log<level::ERR>(
+                                    "Error reading property 'Present'",
+                                    entry("PATH=%s", path.c_str()));
+                                *failed = true;
+                                return;
+                            }
+                            // the signals received meanwhile are newer
+                            cpuPresence.emplace(index,
+                                                std::get<bool>(it->second));
+                        });
+                }
+                catch (const sdbusplus::exception::exception& ex)
+                {
+                    log<level::DEBUG>("Error while calling GetAll",
+                                      entry("SERVICE=%s", owner.c_str()),
+                                      entry("PATH=%s", path.c_str()),
+                                      entry("WHAT=%s", ex.what()));
+                    *failed = true;
+                    break;
+                }
+            }
+            cpuCalls.join([this, failed]() {
+                if (*failed)
+                {
+                    cpuCalls.cancel();
+                    primeCPUPresenceDelayed(retryDelay);
+                    return;
+                }
+                cpuPresenceState = PrimeState::done;
+                cpuPresenceChanged();
+            });
+        });
+}
+
+void FruInventory::primeCPUPresenceDelayed(int delay)
+{
+    // this implicitly cancels the timer
+    cpuTimer.expires_from_now(boost::posix_time::seconds(delay));
+    cpuTimer.async_wait([this](const boost::system::error_code& err) {
+        if (err == boost::asio::error::operation_aborted)
+        {
+            /* we were canceled*/
+            return;
+        }
+        else if (err)
+        {
+            log<level::ERR>("Timer error",
+                            entry("WHAT=%s", err.message().c_str()));
+            return;
+        }
+        primeCPUPresence();
+    });
+}
+
+void FruInventory::cpuChanged(sdbusplus::message::message& msg)
+{
+    const auto index = cpuIndex(msg.get_path());
+    if (!index)
+    {
+        return;
+    }
+
+    Interface interface;
+    DbusProperties properties;
+    msg.read(interface, properties);
+    const auto it = properties.find(dbus::inventory::properties::Present);
+    const bool* present =
+        it != properties.end() ? std::get_if<bool>(&it->second) : nullptr;
+    if (present)
+    {
+        cpuPresence[*index] = *present;
+        cpuPresenceChanged();
+    }
+}
+
+void FruInventory::cpuAdded(sdbusplus::message::message& msg)
+{
+    sdbusplus::message::object_path path;
+    std::map<Interface, DbusProperties> interfaces;
+    msg.read(path, interfaces);
+
+    const auto index = cpuIndex(path.str);
+    const auto ifaceIt = interfaces.find(dbus::inventory::interface);
+    if (!index || ifaceIt == interfaces.end())
+    {
+        return;
+    }
+    const auto& properties = ifaceIt->second;
+    const auto it = properties.find(dbus::inventory::properties::Present);
+    const bool* present =
+        it != properties.end() ? std::get_if<bool>(&it->second) : nullptr;
+    if (present)
+    {
+        cpuPresence[*index] = *present;
+        cpuPresenceChanged();
+    }
+}
+
+void FruInventory::cpuRemoved(sdbusplus::message::message& msg)
+{
+    sdbusplus::message::object_path path;
+    std::vector<Interface> interfaces;
+    msg.read(path, interfaces);
+
+    const auto index = cpuIndex(path.str);
+    if (index &&
+        std::find(interfaces.begin(), interfaces.end(),
+                  dbus::inventory::interface) != interfaces.end() &&
+        cpuPresence.erase(*index))
+    {
+        cpuPresenceChanged();
+    }
+}
+
+/**
+ * @brief Pass the changed CPU presence to the HW manager
+ */
+void FruInventory::cpuPresenceChanged()
+{
+    if (manager.config.haveCPUFans && cpuPresenceState == PrimeState::done)
+    {
+        manager.config.cpuPresence = cpuPresence;
+        publish();
+    }
+}
+
+/**
+ * @brief Publish the HW manager configuration
+ *
+ * The HW manager objects are recreated only if the configuration differs from
+ * the published one. If CPU fans are used, the configuration is not published
+ * until presence of all the CPUs is known.
+ */
+void FruInventory::publish()
+{
+    if (manager.config.haveCPUFans && cpuPresenceState != PrimeState::done)
+    {
+        if (cpuPresenceState == PrimeState::none)
+        {
+            primeCPUPresence();
+        }
+        return;
+    }
+    manager.publish();
+    manager.runDetectFans();
+    log<level::DEBUG>("Scan done");
+}
@@ -0,0 +1,94 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (C) 2022, KNS Group LLC (YADRO)
+ */
+
+#pragma once
+
+#include "common/async_call.hpp"
+#include "dbus.hpp"
+#include "hw_mngr.hpp"
+#include "pcie_cfg.h"
+
+#include <boost/asio/deadline_timer.hpp>
+#include <boost/asio/io_service.hpp>
+#include <sdbusplus/asio/connection.hpp>
+#include <sdbusplus/bus/match.hpp>
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * @class FruInventory
+ *
+ * This class keeps a local copy of the FRU devices and applies the options
+ * they carry to the HW manager and to the PCIe bifurcation settings. The FRU
+ * devices are read once, later the copy is updated from the signal contents,
+ * so only the option groups affected by a change are recomputed.
+ */
+class FruInventory
+{
+  public:
+    FruInventory(const FruInventory&) = delete;
+    FruInventory& operator=(const FruInventory&) = delete;
+
+    FruInventory(boost::asio::io_service& io,
+                 std::shared_ptr<sdbusplus::asio::connection>& systemBus,
+                 HWManager& manager);
+
+    /**
+     * @brief Read all the FRU devices and apply their options
+     */
+    void load();
+
+  private:
+    void loadDelayed(int delay);
+    void loadCompleted(const ManagedObjectType& objects);
+    void fruChanged(sdbusplus::message::message& msg);
+    void fruAdded(sdbusplus::message::message& msg);
+    void fruRemoved(sdbusplus::message::message& msg);
+    void cpuChanged(sdbusplus::message::message& msg);
+    void cpuAdded(sdbusplus::message::message& msg);
+    void cpuRemoved(sdbusplus::message::message& msg);
+    bool isUpToDate();
+    void updateObject(const std::string& path, const DbusProperties& changes);
+    void updateManagerConfig();
+    void updatePCIeConfig();
+    void primeCPUPresence();
+    void primeCPUPresenceDelayed(int delay);
+    void cpuPresenceChanged();
+    void publish();
+
+    boost::asio::io_service& io;
+    std::shared_ptr<sdbusplus::asio::connection>& systemBus;
+    HWManager& manager;
+    pcieCfg pcieConfiguration;
+
+    /* FRU devices: object path -> FruDevice properties */
+    std::map<std::string, DbusProperties> fruObjects;
+    /* Whether the FRU devices have been read */
+    bool loaded = false;
+    /* Whether a FRU device has been changed while they were being read */
+    bool loadStale = false;
+    /* Pending GetManagedObjects request */
+    std::unique_ptr<common::AsyncCall> loadCall;
+    boost::asio::deadline_timer loadTimer;
+
+    enum class PrimeState
+    {
+        none,
+        pending,
+        done
+    };
+    /* CPU presence: CPU index -> present, updated by the signals */
+    std::map<size_t, bool> cpuPresence;
+    /* Whether presence of all the CPUs has been read */
+    PrimeState cpuPresenceState = PrimeState::none;
+    /* Pending CPU presence requests */
+    common::AsyncCallGroup cpuCalls;
+    boost::asio::deadline_timer cpuTimer;
+
+    std::vector<std::unique_ptr<sdbusplus::bus::match::match>> matches;
+};
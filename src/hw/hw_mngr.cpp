@@ -12,6 +12,7 @@
 #include <nlohmann/json.hpp>
 #include <phosphor-logging/log.hpp>
 
+#include <algorithm>
 #include <charconv>
 #include <filesystem>
 #include <fstream>
@@ -23,11 +24,16 @@
 using namespace nlohmann;
 
 namespace fs = std::filesystem;
+namespace sdbusRule = sdbusplus::bus::match::rules;
 using namespace phosphor::logging;
 
+static constexpr uint64_t dbusTimeout = 1 * 1000 * 1000; // Set timeout to 1s
+
 namespace fans
 {
 constexpr int maxErrorAttempts = 20;
+// delay of the PID zones lookup after a service has appeared, seconds
+constexpr int pidZonesLookupDelay = 2;
 const std::string emptyString = "";
 const std::string sysHwmonPath = "/sys/class/hwmon/";
 const std::string sysHwmonFile = "name";
@@ -150,7 +156,8 @@ uint32_t getHwmonValue(const std::string& pathname)
 using namespace fans;
 
 HWManager::HWManager(boost::asio::io_service& io, sdbusplus::bus::bus& bus) :
-    io(io), bus(bus), powerState(bus)
+    mapper(bus, dbusTimeout), io(io), bus(bus),
+    fanSpeedCalls(bus, dbusTimeout), pidZonesTimer(io), powerState(bus)
 {
     loadSystemFanFeatures();
 
@@ -416,23 +423,27 @@ void HWManager::publish()
 
     configActive = config;
 
-    auto matchPIDZone = std::make_unique<sdbusplus::bus::match::match>(
+    matches.emplace_back(std::make_unique<sdbusplus::bus::match::match>(
         bus,
         std::string("type='signal',member='PropertiesChanged',path_"
                     "namespace='") +
             dbus::pid::path + "',arg0namespace='" + dbus::pid::interface + "'",
-        [&](sdbusplus::message::message& message) {
-            if (message.is_method_error())
-            {
-                log<level::ERR>("PropertiesChanged signal error");
-                return;
-            }
-
-            setFanSpeedDelayed();
-        });
-    matches.emplace_back(std::move(matchPIDZone));
-
-    setFanSpeedDelayed();
+        [this](sdbusplus::message::message& msg) { pidZoneChanged(msg); }));
+    matches.emplace_back(std::make_unique<sdbusplus::bus::match::match>(
+        bus,
+        sdbusRule::interfacesAdded() +
+            sdbusRule::argNpath(0, std::string(dbus::pid::path) + "/"),
+        [this](sdbusplus::message::message& msg) { pidZoneAdded(msg); }));
+    matches.emplace_back(std::make_unique<sdbusplus::bus::match::match>(
+        bus,
+        sdbusRule::interfacesRemoved() +
+            sdbusRule::argNpath(0, std::string(dbus::pid::path) + "/"),
+        [this](sdbusplus::message::message& msg) { pidZoneRemoved(msg); }));
+    matches.emplace_back(std::make_unique<sdbusplus::bus::match::match>(
+        bus, sdbusRule::nameOwnerChanged(),
+        [this](sdbusplus::message::message& msg) { pidOwnerChanged(msg); }));
+
+    setFanSpeed();
 }
 
 void HWManager::clear()
@@ -456,120 +467,317 @@ void HWManager::clear()
     }
 }
 
+/**
+ * @brief Enforce minimum fan speed of all the PID zones
+ *
+ * The zones are looked up only once, later they are tracked by the signals.
+ */
 void HWManager::setFanSpeed()
 {
-    SubTreeType objects;
-    auto getObjects =
-        bus.new_method_call(dbus::mapper::busName, dbus::mapper::path,
-                            dbus::mapper::interface, dbus::mapper::subtree);
-    getObjects.append(dbus::pid::path, 0,
-                      std::array<std::string, 1>{dbus::pid::interface});
+    // the previous pass is superseded
+    fanSpeedCalls.cancel();
+    if (!pidZones.empty())
+    {
+        for (const auto& [zoneName, zone] : pidZones)
+        {
+            readZoneMinSpeed(zone.first, zone.second);
+        }
+        return;
+    }
+
+    mapper.getSubTree(
+        dbus::pid::path, 0, {dbus::pid::interface},
+        [this](const std::optional<SubTreeType>& objects) {
+            if (!objects)
+            {
+                return;
+            }
+            if (!objects->empty())
+            {
+                pidZonesLost = false;
+            }
+            for (const auto& [path, objDict] : *objects)
+            {
+                if (objDict.empty())
+                {
+                    continue;
+                }
+                const std::string& owner = objDict.begin()->first;
+                pidZones[fs::path(path).filename()] = {owner, path};
+                readZoneMinSpeed(owner, path);
+            }
+        });
+}
+
+/**
+ * @brief Get minimum fan speed required for the PID zone
+ *
+ * @param[in] zoneName - PID zone name
+ * @return required speed, zero if the zone is not restricted
+ */
+double HWManager::requiredMinSpeed(const std::string& zoneName) const
+{
+    const auto it = configActive.chassisFans.find(zoneName);
+    return it != configActive.chassisFans.end() ? it->second.fanMinSpeed : 0;
+}
+
+/**
+ * @brief Read minimum fan speed of the PID zone and enforce it
+ *
+ * @param[in] owner - PID zone service
+ * @param[in] path - PID zone object path
+ */
+void HWManager::readZoneMinSpeed(const std::string& owner,
+                                 const std::string& path)
+{
+    if (!requiredMinSpeed(fs::path(path).filename()))
+    {
+        return;
+    }
 
+    auto getProperty =
+        bus.new_method_call(owner.c_str(), path.c_str(),
+                            dbus::properties::interface, dbus::properties::get);
+    getProperty.append(dbus::pid::interface,
+                       dbus::pid::properties::MinThermalOutput);
+    log<level::DEBUG>("Calling Get for PID Zone object");
     try
     {
-        log<level::DEBUG>("Calling GetSubTree for PID Zones");
-        bus.call(getObjects).read(objects);
-        log<level::DEBUG>("GetSubTree call done");
+        fanSpeedCalls.call(
+            getProperty,
+            [this, owner, path](sdbusplus::message::message& reply) {
+                if (common::AsyncCall::isError(reply))
+                {
+                    log<level::ERR>(
+                        "Error while calling Get",
+                        entry("SERVICE=%s", owner.c_str()),
+                        entry("PATH=%s", path.c_str()),
+                        entry("INTERFACE=%s", dbus::pid::interface),
+                        entry("WHAT=%s",
+                              common::AsyncCall::errorMessage(reply).c_str()));
+                    return;
+                }
+                log<level::DEBUG>("Get call done");
+
+                DbusPropVariant data;
+                reply.read(data);
+                const double* curValue = std::get_if<double>(&data);
+                if (!curValue)
+                {
+                    log<level::ERR>("Error reading property 'MinThermalOutput'",
+                                    entry("PATH=%s", path.c_str()));
+                    return;
+                }
+                checkZoneMinSpeed(owner, path, *curValue);
+            });
     }
-    catch (const sdbusplus::exception::SdBusError& ex)
+    catch (const sdbusplus::exception::exception& ex)
     {
-        log<level::ERR>("Error while calling GetSubTree",
+        log<level::ERR>("Error while calling Get",
+                        entry("SERVICE=%s", owner.c_str()),
+                        entry("PATH=%s", path.c_str()),
+                        entry("INTERFACE=%s", dbus::pid::interface),
                         entry("WHAT=%s", ex.what()));
+    }
+}
+
+/**
+ * @brief Raise minimum fan speed of the PID zone up to the required one
+ *
+ * @param[in] owner - PID zone service
+ * @param[in] path - PID zone object path
+ * @param[in] curValue - current MinThermalOutput value
+ */
+void HWManager::checkZoneMinSpeed(const std::string& owner,
+                                  const std::string& path, double curValue)
+{
+    const std::string zoneName = fs::path(path).filename();
+    const double fanMinSpeed = requiredMinSpeed(zoneName);
+    if (curValue >= fanMinSpeed)
+    {
         return;
     }
 
-    for (const auto& [path, objDict] : objects)
+    sd_journal_send(
+        "MESSAGE=%s", "Fan PWM minimum changed due to hardware policy",
+        "PRIORITY=%i", LOG_INFO, "ZONE_NAME=%s", zoneName.c_str(),
+        "CUR_VALUE=%0.0f", curValue, "NEW_VALUE=%0.0f", fanMinSpeed,
+        "REDFISH_MESSAGE_ID=%s", "OpenBMC.0.1.FanMinPwmRestricted",
+        "REDFISH_MESSAGE_ARGS=%s,%0.0f,%0.0f", zoneName.c_str(), curValue,
+        fanMinSpeed, NULL);
+
+    DbusPropVariant data = fanMinSpeed;
+    auto setProperty =
+        bus.new_method_call(owner.c_str(), path.c_str(),
+                            dbus::properties::interface, dbus::properties::set);
+    setProperty.append(dbus::pid::interface,
+                       dbus::pid::properties::MinThermalOutput, data);
+    log<level::DEBUG>("Calling Set for PID Zone object");
+    try
+    {
+        common::callDetached(
+            bus, setProperty,
+            [owner, path](sdbusplus::message::message& reply) {
+                if (common::AsyncCall::isError(reply))
+                {
+                    log<level::ERR>(
+                        "Error while calling Set",
+                        entry("SERVICE=%s", owner.c_str()),
+                        entry("PATH=%s", path.c_str()),
+                        entry("INTERFACE=%s", dbus::pid::interface),
+                        entry("WHAT=%s",
+                              common::AsyncCall::errorMessage(reply).c_str()));
+                    return;
+                }
+                log<level::DEBUG>("Set call done");
+            },
+            dbusTimeout);
+    }
+    catch (const sdbusplus::exception::exception& ex)
     {
-        fs::path zonePath = path;
-        std::string zoneName = zonePath.filename();
-        const std::string& owner = objDict.begin()->first;
+        log<level::ERR>("Error while calling Set",
+                        entry("SERVICE=%s", owner.c_str()),
+                        entry("PATH=%s", path.c_str()),
+                        entry("INTERFACE=%s", dbus::pid::interface),
+                        entry("WHAT=%s", ex.what()));
+    }
+}
 
-        auto it = config.chassisFans.find(zoneName);
-        if (it == config.chassisFans.end() || !it->second.fanMinSpeed)
-        {
-            continue;
-        }
-        double fanMinSpeed = it->second.fanMinSpeed;
+/**
+ * @brief PropertiesChanged handler of the PID zones
+ *
+ * The new value comes with the signal, so it is checked without any request.
+ */
+void HWManager::pidZoneChanged(sdbusplus::message::message& msg)
+{
+    Interface interface;
+    DbusProperties properties;
+    msg.read(interface, properties);
 
-        DbusPropVariant data;
-        auto getProperty = bus.new_method_call(owner.c_str(), path.c_str(),
-                                               dbus::properties::interface,
-                                               dbus::properties::get);
-        getProperty.append(dbus::pid::interface,
-                           dbus::pid::properties::MinThermalOutput);
+    const std::string path = msg.get_path();
+    pidZones[fs::path(path).filename()] = {msg.get_sender(), path};
 
-        try
-        {
-            log<level::DEBUG>("Calling Get for PID Zone object");
-            bus.call(getProperty).read(data);
-            log<level::DEBUG>("Get call done");
-        }
-        catch (const sdbusplus::exception::exception& ex)
-        {
-            log<level::ERR>("Error while calling Get",
-                            entry("SERVICE=%s", owner.c_str()),
-                            entry("PATH=%s", path.c_str()),
-                            entry("INTERFACE=%s", dbus::pid::interface),
-                            entry("WHAT=%s", ex.description()));
-            return;
-        }
+    const auto it = properties.find(dbus::pid::properties::MinThermalOutput);
+    if (it == properties.end())
+    {
+        return;
+    }
+    const double* curValue = std::get_if<double>(&it->second);
+    if (curValue)
+    {
+        checkZoneMinSpeed(msg.get_sender(), path, *curValue);
+    }
+}
 
-        double curValue;
-        try
-        {
-            curValue = std::get<double>(data);
-        }
-        catch (std::invalid_argument&)
-        {
-            log<level::ERR>("Error reading property 'MinThermalOutput'",
-                            entry("PATH=%s", path.c_str()));
-            return;
-        }
-        if (curValue >= fanMinSpeed)
-        {
-            continue;
-        }
+/**
+ * @brief InterfacesAdded handler of the PID zones
+ */
+void HWManager::pidZoneAdded(sdbusplus::message::message& msg)
+{
+    sdbusplus::message::object_path path;
+    std::map<Interface, DbusProperties> interfaces;
+    msg.read(path, interfaces);
 
-        sd_journal_send(
-            "MESSAGE=%s", "Fan PWM minimum changed due to hardware policy",
-            "PRIORITY=%i", LOG_INFO, "ZONE_NAME=%s", zoneName.c_str(),
-            "CUR_VALUE=%0.0f", curValue, "NEW_VALUE=%0.0f", fanMinSpeed,
-            "REDFISH_MESSAGE_ID=%s", "OpenBMC.0.1.FanMinPwmRestricted",
-            "REDFISH_MESSAGE_ARGS=%s,%0.0f,%0.0f", zoneName.c_str(), curValue,
-            fanMinSpeed, NULL);
-
-        data = fanMinSpeed;
-        auto setProperty = bus.new_method_call(owner.c_str(), path.c_str(),
-                                               dbus::properties::interface,
-                                               dbus::properties::set);
-        setProperty.append(dbus::pid::interface,
-                           dbus::pid::properties::MinThermalOutput, data);
+    const auto ifaceIt = interfaces.find(dbus::pid::interface);
+    if (ifaceIt == interfaces.end())
+    {
+        return;
+    }
+    pidZones[fs::path(path.str).filename()] = {msg.get_sender(), path.str};
 
-        try
+    const auto& properties = ifaceIt->second;
+    const auto it = properties.find(dbus::pid::properties::MinThermalOutput);
+    if (it == properties.end())
+    {
+        return;
+    }
+    const double* curValue = std::get_if<double>(&it->second);
+    if (curValue)
+    {
+        checkZoneMinSpeed(msg.get_sender(), path.str, *curValue);
+    }
+}
+
+/**
+ * @brief InterfacesRemoved handler of the PID zones
+ */
+void HWManager::pidZoneRemoved(sdbusplus::message::message& msg)
+{
+    sdbusplus::message::object_path path;
+    std::vector<Interface> interfaces;
+    msg.read(path, interfaces);
+
+    if (std::find(interfaces.begin(), interfaces.end(), dbus::pid::interface) ==
+        interfaces.end())
+    {
+        return;
+    }
+    const auto it = pidZones.find(fs::path(path.str).filename());
+    if (it != pidZones.end() && it->second.second == path.str)
+    {
+        pidZones.erase(it);
+    }
+}
+
+/**
+ * @brief NameOwnerChanged handler, drops the PID zones of a service that has
+ *        left the bus
+ *
+ * The requests are not sent to a dead connection then. A restarted service
+ * doesn't announce its zones, so they are looked up again (and the minimum
+ * speed is enforced) once a service name appears on the bus.
+ */
+void HWManager::pidOwnerChanged(sdbusplus::message::message& msg)
+{
+    std::string name;
+    std::string oldOwner;
+    std::string newOwner;
+    try
+    {
+        msg.read(name, oldOwner, newOwner);
+    }
+    catch (const sdbusplus::exception::exception&)
+    {
+        pidZones.clear();
+        pidZonesLost = true;
+        return;
+    }
+    if (oldOwner.empty())
+    {
+        // unique connection names are skipped, the service is looked up
+        // by its well-known name
+        if (pidZonesLost && !newOwner.empty() && name.front() != ':')
         {
-            log<level::DEBUG>("Calling Set for PID Zone object");
-            bus.call(setProperty);
-            log<level::DEBUG>("Set call done");
+            lookupPidZonesDelayed();
         }
-        catch (const sdbusplus::exception::exception& ex)
+        return;
+    }
+
+    for (auto it = pidZones.begin(); it != pidZones.end();)
+    {
+        const std::string& owner = it->second.first;
+        if (owner == name || owner == oldOwner)
         {
-            log<level::ERR>("Error while calling Set",
-                            entry("SERVICE=%s", owner.c_str()),
-                            entry("PATH=%s", path.c_str()),
-                            entry("INTERFACE=%s", dbus::pid::interface),
-                            entry("WHAT=%s", ex.description()));
-            return;
+            it = pidZones.erase(it);
+            pidZonesLost = true;
+            continue;
         }
+        ++it;
     }
 }
 
-void HWManager::setFanSpeedDelayed()
+/**
+ * @brief Look the PID zones up again after a while
+ *
+ * The objects of a service may be created after its name is requested, so
+ * the lookup is delayed. Each new service restarts the delay.
+ */
+void HWManager::lookupPidZonesDelayed()
 {
-    static boost::asio::deadline_timer filterTimer(io);
-
     // this implicitly cancels the timer
-    filterTimer.expires_from_now(boost::posix_time::seconds(5));
-    filterTimer.async_wait([&](const boost::system::error_code& err) {
+    pidZonesTimer.expires_from_now(
+        boost::posix_time::seconds(pidZonesLookupDelay));
+    pidZonesTimer.async_wait([this](const boost::system::error_code& err) {
         if (err == boost::asio::error::operation_aborted)
         {
             /* we were canceled*/
@@ -581,7 +789,10 @@ void HWManager::setFanSpeedDelayed()
                             entry("WHAT=%s", err.message().c_str()));
             return;
         }
-        setFanSpeed();
+        if (pidZones.empty())
+        {
+            setFanSpeed();
+        }
     });
 }
 
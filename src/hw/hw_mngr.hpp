@@ -6,9 +6,12 @@
 #pragma once
 
 #include "common.hpp"
+#include "common/async_call.hpp"
+#include "common/mapper_cache.hpp"
 #include "options.hpp"
 #include "product_registry.hpp"
 
+#include <boost/asio/deadline_timer.hpp>
 #include <sdbusplus/asio/connection.hpp>
 #include <sdbusplus/bus.hpp>
 
@@ -105,11 +108,20 @@ class HWManager
     void publish();
 
     HWManagerData config;
+    common::MapperCache mapper;
 
   private:
     void clear();
     void setFanSpeed();
-    void setFanSpeedDelayed();
+    double requiredMinSpeed(const std::string& zoneName) const;
+    void readZoneMinSpeed(const std::string& owner, const std::string& path);
+    void checkZoneMinSpeed(const std::string& owner, const std::string& path,
+                           double curValue);
+    void pidZoneChanged(sdbusplus::message::message& msg);
+    void pidZoneAdded(sdbusplus::message::message& msg);
+    void pidZoneRemoved(sdbusplus::message::message& msg);
+    void pidOwnerChanged(sdbusplus::message::message& msg);
+    void lookupPidZonesDelayed();
     void saveSystemFanFeatures();
     void loadSystemFanFeatures();
     void detectFansDelayed(uint32_t delaySecs);
@@ -125,6 +137,13 @@ class HWManager
     boost::asio::io_service& io;
     sdbusplus::bus::bus& bus;
     std::vector<std::unique_ptr<sdbusplus::bus::match::match>> matches;
+    /* PID zones requests of the last setFanSpeed() */
+    common::AsyncCallGroup fanSpeedCalls;
+    /* PID zones: zone name -> (owner, object path) */
+    std::map<std::string, std::pair<std::string, std::string>> pidZones;
+    /* zones were dropped with their service, look them up when it is back */
+    bool pidZonesLost = false;
+    boost::asio::deadline_timer pidZonesTimer;
     HWManagerData configActive;
     std::vector<std::shared_ptr<Chassis>> chassis;
     std::vector<std::shared_ptr<Fan>> fans;
@@ -5,19 +5,20 @@
 
 #include "pcie_cfg.h"
 
+#include "common/async_call.hpp"
 #include "dbus.hpp"
 #include "options.hpp"
 
 #include <phosphor-logging/log.hpp>
 #include <xyz/openbmc_project/Control/PCIe/server.hpp>
 
+#include <algorithm>
 #include <charconv>
+#include <optional>
 
 using namespace phosphor::logging;
 
 using namespace sdbusplus::xyz::openbmc_project::Control::server;
-using BifurcationConfiguration =
-    std::vector<std::tuple<uint8_t, uint8_t, PCIe::BifurcationMode>>;
 
 // PCIe Bifurcation mode
 static constexpr uint8_t pcieBifurcateX4X4X4X4 = 0;
@@ -41,21 +42,12 @@ static constexpr uint8_t bmcPcieBifurcateDisabled = 0xDD;
 /**
  * @brief Lookup dbus service for interface
  *
- * @param[in] interface     DBus interface to lookup
+ * @param[in] objects       objects implementing the interface
  * @return service name and resource path
  */
 static std::tuple<std::string, std::string>
-    dbusGetSetviceAndPath(sdbusplus::bus::bus& bus,
-                          const std::string& interface)
+    dbusGetSetviceAndPath(const SubTreeType& objects)
 {
-    auto getObjects =
-        bus.new_method_call(dbus::mapper::busName, dbus::mapper::path,
-                            dbus::mapper::interface, dbus::mapper::subtree);
-    getObjects.append("/", 0, std::array<std::string, 1>{interface});
-
-    SubTreeType objects;
-    bus.call(getObjects).read(objects);
-
     if (objects.size() != 1)
     {
         throw sdbusplus::exception::SdBusError(-EINVAL,
@@ -177,10 +169,19 @@ bool pcieCfg::addBifurcationConfig(const int& socket,
     return true;
 }
 
-pcieCfg::~pcieCfg()
+void pcieCfg::clear()
+{
+    bifurcationConfig.clear();
+}
+
+/**
+ * @brief Convert the collected configuration to the settings format
+ *
+ * @return configuration sorted by socket and IOU number
+ */
+BifurcationConfiguration pcieCfg::getConfig() const
 {
     BifurcationConfiguration config;
-    std::string settingsPath, settingsService;
     for (auto& [addr, mode] : bifurcationConfig)
     {
         const uint8_t socket = (addr >> 8) & 0xff;
@@ -225,32 +226,193 @@ pcieCfg::~pcieCfg()
         }
         config.emplace_back(std::make_tuple(socket, iouNumber, bifurcation));
     }
+    return config;
+}
+
+/**
+ * @brief Log per socket/IOU differences between two configurations
+ */
+static void logChanges(const BifurcationConfiguration& oldConfig,
+                       const BifurcationConfiguration& newConfig)
+{
+    std::map<std::pair<uint8_t, uint8_t>,
+             std::pair<std::string, std::string>>
+        changes;
+    for (const auto& [socket, iou, mode] : oldConfig)
+    {
+        changes[{socket, iou}].first = convertForMessage(mode);
+    }
+    for (const auto& [socket, iou, mode] : newConfig)
+    {
+        changes[{socket, iou}].second = convertForMessage(mode);
+    }
+    for (const auto& [port, modes] : changes)
+    {
+        if (modes.first != modes.second)
+        {
+            log<level::INFO>(
+                "PCIe bifurcation changed", entry("SOCKET=%d", port.first),
+                entry("IOU=%d", port.second),
+                entry("OLD=%s", modes.first.empty() ? "none"
+                                                    : modes.first.c_str()),
+                entry("NEW=%s", modes.second.empty() ? "none"
+                                                     : modes.second.c_str()));
+        }
+    }
+}
 
+void pcieCfg::apply()
+{
+    BifurcationConfiguration config = getConfig();
+    if (config.empty() && !requestedConfig)
+    {
+        // nothing has been configured by FRU, the settings are left as is,
+        // but a configuration applied before is cleared once its options
+        // are gone (e.g. the riser is removed)
+        log<level::DEBUG>("No PCIe bifurcation configuration");
+        return;
+    }
+    if (requestedConfig && *requestedConfig == config)
+    {
+        return;
+    }
+    requestedConfig = std::move(config);
+
+    mapper.getSubTree(
+        "/", 0, {PCIe::interface},
+        [this](const std::optional<SubTreeType>& objects) {
+            if (!objects)
+            {
+                requestedConfig.reset();
+                return;
+            }
+            std::string settingsPath, settingsService;
+            try
+            {
+                std::tie(settingsPath, settingsService) =
+                    dbusGetSetviceAndPath(*objects);
+            }
+            catch (const sdbusplus::exception::exception& ex)
+            {
+                log<level::ERR>("Settings lookup error",
+                                entry("VALUE=%s", ex.what()));
+                requestedConfig.reset();
+                return;
+            }
+
+            if (currentConfig)
+            {
+                write(settingsService, settingsPath);
+            }
+            else
+            {
+                read(settingsService, settingsPath);
+            }
+        });
+}
+
+/**
+ * @brief Read the current settings value and write the new one if it differs
+ *
+ * @param[in] service - settings service
+ * @param[in] path - settings object path
+ */
+void pcieCfg::read(const std::string& service, const std::string& path)
+{
+    auto getProp =
+        bus.new_method_call(service.c_str(), path.c_str(),
+                            dbus::properties::interface, dbus::properties::get);
+    getProp.append(PCIe::interface, dbus::pcie_cfg::properties::bifurcation);
     try
     {
-        std::tie(settingsPath, settingsService) =
-            dbusGetSetviceAndPath(bus, PCIe::interface);
+        call = std::make_unique<common::AsyncCall>(
+            bus, getProp,
+            [this, service, path](sdbusplus::message::message& reply) {
+                if (common::AsyncCall::isError(reply))
+                {
+                    log<level::ERR>(
+                        "Get configuration error",
+                        entry("VALUE=%s",
+                              common::AsyncCall::errorMessage(reply).c_str()));
+                }
+                else
+                {
+                    try
+                    {
+                        std::variant<BifurcationConfiguration> value;
+                        reply.read(value);
+                        currentConfig =
+                            std::get<BifurcationConfiguration>(value);
+                        std::sort(currentConfig->begin(),
+                                  currentConfig->end());
+                    }
+                    catch (const sdbusplus::exception::exception& ex)
+                    {
+                        log<level::ERR>("Get configuration error",
+                                        entry("VALUE=%s", ex.what()));
+                        currentConfig.reset();
+                    }
+                }
+                // the configuration is written anyway if it can't be read
+                write(service, path);
+            });
     }
     catch (const sdbusplus::exception::exception& ex)
     {
-        log<level::ERR>("Settings lookup error", entry("VALUE=%s", ex.what()));
+        log<level::ERR>("Get configuration error",
+                        entry("VALUE=%s", ex.what()));
+        write(service, path);
+    }
+}
+
+/**
+ * @brief Write the requested configuration if the settings differ
+ *
+ * @param[in] service - settings service
+ * @param[in] path - settings object path
+ */
+void pcieCfg::write(const std::string& service, const std::string& path)
+{
+    if (!requestedConfig)
+    {
+        return;
+    }
+    const BifurcationConfiguration config = *requestedConfig;
+    if (currentConfig && *currentConfig == config)
+    {
+        log<level::DEBUG>("PCIe bifurcation is up to date");
         return;
     }
+    logChanges(currentConfig.value_or(BifurcationConfiguration()), config);
 
     auto setProp =
-        bus.new_method_call(settingsService.c_str(), settingsPath.c_str(),
+        bus.new_method_call(service.c_str(), path.c_str(),
                             dbus::properties::interface, dbus::properties::set);
     setProp.append(PCIe::interface, dbus::pcie_cfg::properties::bifurcation,
                    std::variant<BifurcationConfiguration>(config));
-
     try
     {
-        bus.call(setProp);
+        call = std::make_unique<common::AsyncCall>(
+            bus, setProp, [this, config](sdbusplus::message::message& reply) {
+                if (common::AsyncCall::isError(reply))
+                {
+                    log<level::ERR>(
+                        "Set configuration error",
+                        entry("VALUE=%s",
+                              common::AsyncCall::errorMessage(reply).c_str()));
+                    // the settings are read and written again next time
+                    requestedConfig.reset();
+                    currentConfig.reset();
+                    return;
+                }
+                currentConfig = config;
+            });
     }
     catch (const sdbusplus::exception::exception& ex)
     {
         log<level::ERR>("Set configuration error",
                         entry("VALUE=%s", ex.what()));
-        return;
+        requestedConfig.reset();
+        currentConfig.reset();
     }
 }
@@ -4,17 +4,46 @@
  */
 
 #pragma once
+#include "common/async_call.hpp"
+#include "common/mapper_cache.hpp"
+
 #include <sdbusplus/bus.hpp>
+#include <xyz/openbmc_project/Control/PCIe/server.hpp>
+
+#include <map>
+#include <memory>
+#include <optional>
+#include <tuple>
+#include <vector>
+
+using BifurcationConfiguration = std::vector<
+    std::tuple<uint8_t, uint8_t,
+               sdbusplus::xyz::openbmc_project::Control::server::PCIe::
+                   BifurcationMode>>;
 
 class pcieCfg
 {
   public:
-    pcieCfg(sdbusplus::bus::bus& bus) : bus(bus)
+    pcieCfg(sdbusplus::bus::bus& bus, common::MapperCache& mapper) :
+        bus(bus), mapper(mapper)
     {}
     bool addBifurcationConfig(const int& socket, const std::string& optValue);
-    ~pcieCfg();
+    /** @brief Drop the collected configuration */
+    void clear();
+    /** @brief Write the collected configuration if the settings differ */
+    void apply();
 
   private:
+    BifurcationConfiguration getConfig() const;
+    void read(const std::string& service, const std::string& path);
+    void write(const std::string& service, const std::string& path);
+
     std::map<uint16_t, uint8_t> bifurcationConfig;
+    /* Configuration to be written, nothing if a write has failed */
+    std::optional<BifurcationConfiguration> requestedConfig;
+    /* Configuration stored by the settings service, nothing if unknown */
+    std::optional<BifurcationConfiguration> currentConfig;
+    std::unique_ptr<common::AsyncCall> call;
     sdbusplus::bus::bus& bus;
+    common::MapperCache& mapper;
 };
@@ -5,11 +5,23 @@
 
 #include "backplane_mcu_driver.hpp"
 
+#include <phosphor-logging/log.hpp>
+
+#include <algorithm>
 #include <stdexcept>
+#include <thread>
+
+using namespace phosphor::logging;
 
 /* Backplane MCU request proto version ID */
 constexpr uint8_t mcuGetTypeId = 0x00;
 
+/* MCU reset probe interval after reboot command */
+constexpr std::chrono::milliseconds resetProbeDelay(2);
+/* MCU readiness probe schedule after reset */
+constexpr std::chrono::milliseconds readyProbeMinDelay(20);
+constexpr std::chrono::milliseconds readyProbeMaxDelay(1000);
+
 std::unique_ptr<BackplaneMCUDriver> backplaneMCU(std::string devPath, int addr)
 {
     auto dev = std::make_unique<i2cDev>(devPath, addr);
@@ -28,3 +40,103 @@ std::unique_ptr<BackplaneMCUDriver> backplaneMCU(std::string devPath, int addr)
 
     throw std::runtime_error("Failed to initialize MCU driver");
 }
+
+std::unique_ptr<BackplaneMCUDriver>
+    backplaneMCUWaitReady(const std::string& devPath, int addr,
+                          const std::string& boardType,
+                          std::chrono::milliseconds timeout,
+                          std::chrono::milliseconds& elapsed,
+                          const std::atomic_bool* cancelled)
+{
+    using namespace std::chrono;
+    const auto start = steady_clock::now();
+    auto delay = readyProbeMinDelay;
+    auto isCancelled = [&]() {
+        if (!cancelled || !*cancelled)
+        {
+            return false;
+        }
+        elapsed = duration_cast<milliseconds>(steady_clock::now() - start);
+        log<level::INFO>("Waiting for MCU reboot is cancelled",
+                         entry("I2C_DEV=%s", devPath.c_str()),
+                         entry("ADDR=%d", addr),
+                         entry("ELAPSED_MS=%lld",
+                               static_cast<long long>(elapsed.count())));
+        return true;
+    };
+
+    // wait for the old firmware to leave the bus, otherwise its answer would
+    // be taken for the new firmware being ready
+    bool reset = false;
+    i2cDev dev(devPath, addr);
+    while (dev.isOk())
+    {
+        if (dev.read_byte_data(mcuGetTypeId) < 0)
+        {
+            reset = true;
+            break;
+        }
+        if (isCancelled())
+        {
+            return nullptr;
+        }
+        elapsed = duration_cast<milliseconds>(steady_clock::now() - start);
+        if (elapsed >= timeout)
+        {
+            break;
+        }
+        std::this_thread::sleep_for(
+            std::min<milliseconds>(resetProbeDelay, timeout - elapsed));
+    }
+    if (!reset)
+    {
+        elapsed = duration_cast<milliseconds>(steady_clock::now() - start);
+        log<level::ERR>("MCU has not been reset after reboot command",
+                        entry("I2C_DEV=%s", devPath.c_str()),
+                        entry("ADDR=%d", addr),
+                        entry("BOARD_TYPE=%s", boardType.c_str()),
+                        entry("ELAPSED_MS=%lld",
+                              static_cast<long long>(elapsed.count())));
+        return nullptr;
+    }
+
+    while (true)
+    {
+        if (isCancelled())
+        {
+            return nullptr;
+        }
+        elapsed = duration_cast<milliseconds>(steady_clock::now() - start);
+        if (elapsed >= timeout)
+        {
+            break;
+        }
+        std::this_thread::sleep_for(std::min(delay, timeout - elapsed));
+        delay = std::min(delay * 2, readyProbeMaxDelay);
+
+        try
+        {
+            auto mcu = backplaneMCU(devPath, addr);
+            elapsed = duration_cast<milliseconds>(steady_clock::now() - start);
+            log<level::INFO>("MCU is ready after reboot",
+                             entry("I2C_DEV=%s", devPath.c_str()),
+                             entry("ADDR=%d", addr),
+                             entry("BOARD_TYPE=%s", boardType.c_str()),
+                             entry("REBOOT_TIME_MS=%lld",
+                                   static_cast<long long>(elapsed.count())));
+            return mcu;
+        }
+        catch (const std::exception&)
+        {
+            // not ready yet
+        }
+    }
+
+    log<level::ERR>("MCU is not ready after reboot",
+                    entry("I2C_DEV=%s", devPath.c_str()),
+                    entry("ADDR=%d", addr),
+                    entry("BOARD_TYPE=%s", boardType.c_str()),
+                    entry("TIMEOUT_MS=%lld",
+                          static_cast<long long>(timeout.count())));
+    return nullptr;
+}
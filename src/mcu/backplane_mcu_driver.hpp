@@ -6,11 +6,40 @@
 #pragma once
 #include "common_i2c.hpp"
 
+#include <atomic>
+#include <chrono>
 #include <memory>
 
 class BackplaneMCUDriver;
 std::unique_ptr<BackplaneMCUDriver> backplaneMCU(std::string devPath, int addr);
 
+/**
+ * @brief Wait until MCU comes back after reboot
+ *
+ * The reboot command is acknowledged before the MCU resets, so the old
+ * firmware may still answer right after it. First the MCU is probed every
+ * 2 ms until it stops answering, then it is probed with exponentially growing
+ * intervals (from 20 ms up to 1 s) until it answers again or the timeout
+ * expires. The latter probe is the regular protocol detection, so the
+ * returned driver matches the protocol of the new firmware. The time taken by
+ * reboot is logged along with the board type to help tuning the timeouts.
+ *
+ * @param[in] devPath - I2C bus device file path (e.g. "/dev/i2c-20")
+ * @param[in] addr - 7-bit I2C device address
+ * @param[in] boardType - board type reported by MCU before reboot
+ * @param[in] timeout - overall time limit
+ * @param[out] elapsed - time taken by MCU to get ready
+ * @param[in] cancelled - flag to stop waiting, may be nullptr
+ * @return MCU driver or nullptr if MCU didn't reset or didn't answer in time,
+ *         or waiting has been stopped
+ */
+std::unique_ptr<BackplaneMCUDriver>
+    backplaneMCUWaitReady(const std::string& devPath, int addr,
+                          const std::string& boardType,
+                          std::chrono::milliseconds timeout,
+                          std::chrono::milliseconds& elapsed,
+                          const std::atomic_bool* cancelled = nullptr);
+
 enum class DriveTypes
 {
     Unknown,
@@ -50,9 +79,34 @@ class BackplaneMCUDriver
     virtual DriveTypes driveType(int chanIndex) = 0;
     virtual void setDriveLocationLED(int chanIndex, bool assert) = 0;
     virtual bool getDriveLocationLED(int chanIndex) = 0;
+    /**
+     * @brief Update several location LEDs at once
+     *
+     * @param[in] assertMask - bit mask of the channels to turn LED on
+     * @param[in] deassertMask - bit mask of the channels to turn LED off
+     */
+    virtual void setDriveLocationLEDs(uint8_t assertMask,
+                                      uint8_t deassertMask) = 0;
+    /**
+     * @brief Get bit mask of the channels with location LED turned on
+     */
+    virtual uint8_t getDriveLocationLEDs() = 0;
     virtual void resetDriveLocationLEDs() = 0;
     virtual void setHostPowerState(bool powered) = 0;
-    virtual bool isStateChanged(uint32_t& cache) = 0;
+    /**
+     * @brief Check whether the drives state has changed since the last call
+     *
+     * @param[in,out] cache - drives state read by the previous call
+     * @param[out] replaced - bit mask of the channels where a drive has been
+     *                        removed or inserted since the last call, even if
+     *                        the presence is the same now
+     * @return true if the state has changed
+     */
+    virtual bool isStateChanged(uint32_t& cache, uint8_t& replaced) = 0;
+    /**
+     * @brief Whether isStateChanged() reports the replaced drives
+     */
+    virtual bool reportsReplacement() const = 0;
     virtual bool ping() = 0;
     virtual void reboot() = 0;
     virtual void eraseFlash() = 0;
@@ -79,9 +133,12 @@ class MCUProtoV0 : public BackplaneMCUDriver
     DriveTypes driveType(int chanIndex);
     void setDriveLocationLED(int chanIndex, bool assert);
     bool getDriveLocationLED(int chanIndex);
+    void setDriveLocationLEDs(uint8_t assertMask, uint8_t deassertMask);
+    uint8_t getDriveLocationLEDs();
     void resetDriveLocationLEDs();
     void setHostPowerState(bool powered);
-    bool isStateChanged(uint32_t& cache);
+    bool isStateChanged(uint32_t& cache, uint8_t& replaced);
+    bool reportsReplacement() const;
     bool ping();
     void reboot();
     void eraseFlash();
@@ -111,9 +168,12 @@ class MCUProtoV1 : public BackplaneMCUDriver
     DriveTypes driveType(int chanIndex);
     void setDriveLocationLED(int chanIndex, bool assert);
     bool getDriveLocationLED(int chanIndex);
+    void setDriveLocationLEDs(uint8_t assertMask, uint8_t deassertMask);
+    uint8_t getDriveLocationLEDs();
     void resetDriveLocationLEDs();
     void setHostPowerState(bool powered);
-    bool isStateChanged(uint32_t& cache);
+    bool isStateChanged(uint32_t& cache, uint8_t& replaced);
+    bool reportsReplacement() const;
     bool ping();
     void reboot();
     void eraseFlash();
@@ -204,6 +204,30 @@ bool MCUProtoV0::getDriveLocationLED(int chanIndex)
     throw std::runtime_error("Operation not supported");
 }
 
+void MCUProtoV0::setDriveLocationLEDs(uint8_t assertMask, uint8_t deassertMask)
+{
+    // protocol Version 0 has no bulk command, so the channels are updated
+    // one by one
+    for (int chanIndex = 0; chanIndex < maxChannelsNumber; chanIndex++)
+    {
+        if (assertMask & (1 << chanIndex))
+        {
+            setDriveLocationLED(chanIndex, true);
+        }
+        else if (deassertMask & (1 << chanIndex))
+        {
+            setDriveLocationLED(chanIndex, false);
+        }
+    }
+}
+
+uint8_t MCUProtoV0::getDriveLocationLEDs()
+{
+    log<level::ERR>(
+        "getDriveLocationLEDs not implemented in MCU protocol Version 0");
+    throw std::runtime_error("Operation not supported");
+}
+
 void MCUProtoV0::resetDriveLocationLEDs()
 {
     for (int chanIndex = 0; chanIndex < maxChannelsNumber; chanIndex++)
@@ -226,9 +250,11 @@ void MCUProtoV0::setHostPowerState(bool powered)
     }
 }
 
-bool MCUProtoV0::isStateChanged(uint32_t& cache)
+bool MCUProtoV0::isStateChanged(uint32_t& cache, uint8_t& replaced)
 {
     bool res;
+    // protocol v0 has no presence change latch
+    replaced = 0;
     getDrivesPresence();
     getDrivesFailures();
     uint32_t newState = dPresence | (dFailures >> 8);
@@ -237,6 +263,11 @@ bool MCUProtoV0::isStateChanged(uint32_t& cache)
     return res;
 }
 
+bool MCUProtoV0::reportsReplacement() const
+{
+    return false;
+}
+
 bool MCUProtoV0::ping()
 {
     int res = dev->read_byte_data(OPC_GET_IDENT);
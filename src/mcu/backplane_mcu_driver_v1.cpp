@@ -132,17 +132,22 @@ DriveTypes MCUProtoV1::driveType(int chanIndex)
 }
 
 void MCUProtoV1::setDriveLocationLED(int chanIndex, bool assert)
+{
+    const uint8_t mask = 1 << chanIndex;
+    setDriveLocationLEDs(assert ? mask : 0, assert ? 0 : mask);
+}
+
+bool MCUProtoV1::getDriveLocationLED(int chanIndex)
+{
+    const uint8_t locationLEDs = getDrivesLocate();
+    return locationLEDs & (1 << chanIndex);
+}
+
+void MCUProtoV1::setDriveLocationLEDs(uint8_t assertMask, uint8_t deassertMask)
 {
     const uint8_t curLocationLEDs = getDrivesLocate();
-    uint8_t locationLEDs = curLocationLEDs;
-    if (assert)
-    {
-        locationLEDs |= 1 << chanIndex;
-    }
-    else
-    {
-        locationLEDs &= ~(1 << chanIndex);
-    }
+    const uint8_t locationLEDs =
+        (curLocationLEDs & ~deassertMask) | assertMask;
     if (locationLEDs == curLocationLEDs)
     {
         return;
@@ -159,10 +164,9 @@ void MCUProtoV1::setDriveLocationLED(int chanIndex, bool assert)
     }
 }
 
-bool MCUProtoV1::getDriveLocationLED(int chanIndex)
+uint8_t MCUProtoV1::getDriveLocationLEDs()
 {
-    const uint8_t locationLEDs = getDrivesLocate();
-    return locationLEDs & (1 << chanIndex);
+    return getDrivesLocate();
 }
 
 void MCUProtoV1::resetDriveLocationLEDs()
@@ -191,7 +195,7 @@ void MCUProtoV1::setHostPowerState(bool powered)
     }
 }
 
-bool MCUProtoV1::isStateChanged(uint32_t& cache)
+bool MCUProtoV1::isStateChanged(uint32_t& cache, uint8_t& replaced)
 {
     bool ret;
     getDrivesPresence();
@@ -199,11 +203,9 @@ bool MCUProtoV1::isStateChanged(uint32_t& cache)
     uint32_t newState = dPresence | (dFailures >> 8);
     ret = (newState != cache);
     cache = newState;
-    if (ret)
-    {
-        return true;
-    }
 
+    // the latch is read even if the state has changed, otherwise it would be
+    // reported again on the next call
     int res = dev->read_byte_data(OPC_GET_DISC_PRESENCE_CHANGED);
     if (res < 0)
     {
@@ -213,13 +215,19 @@ bool MCUProtoV1::isStateChanged(uint32_t& cache)
                         entry("REASON=%s", std::strerror(-res)));
         throw std::runtime_error("Failed to communicate with MCU");
     }
-    if (res > 0)
+    replaced = static_cast<uint8_t>(res);
+    if (replaced)
     {
         ret = true;
     }
     return ret;
 }
 
+bool MCUProtoV1::reportsReplacement() const
+{
+    return true;
+}
+
 bool MCUProtoV1::ping()
 {
     int res = dev->read_byte_data(OPC_GET_IDENT);
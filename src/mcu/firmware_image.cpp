@@ -0,0 +1,36 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (C) 2022, KNS Group LLC (YADRO)
+ */
+
+#include "firmware_image.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+std::shared_ptr<const FirmwareImage>
+    FirmwareImage::open(const std::filesystem::path& path)
+{
+    auto mem = common::MappedMem::open(path);
+    if ((mem.size() < headerSize) || (mem.size() > maxSize))
+    {
+        throw std::runtime_error("Incorrect firmware image size: " +
+                                 std::to_string(mem.size()) + " bytes");
+    }
+
+    // an image with blank (erased or zeroed) header can't be booted by MCU
+    const auto* header = static_cast<const unsigned char*>(mem.data());
+    const auto blank = [header](unsigned char value) {
+        return std::all_of(
+            header, header + headerSize,
+            [value](unsigned char byte) { return byte == value; });
+    };
+    if (blank(0x00) || blank(0xFF))
+    {
+        throw std::runtime_error("Invalid firmware image header: " +
+                                 path.string());
+    }
+
+    return std::shared_ptr<const FirmwareImage>(
+        new FirmwareImage(path, std::move(mem)));
+}
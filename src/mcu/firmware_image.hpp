@@ -0,0 +1,64 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (C) 2022, KNS Group LLC (YADRO)
+ */
+
+#pragma once
+
+#include "common/mmapfile.hpp"
+
+#include <filesystem>
+#include <memory>
+
+/**
+ * @class FirmwareImage
+ *
+ * Backplane MCU firmware image mapped into memory. The image is validated
+ * once on open and then shared read-only by all the MCUs it is written to,
+ * the chunks are sent to MCU directly from the mapping.
+ */
+class FirmwareImage
+{
+  public:
+    FirmwareImage(const FirmwareImage&) = delete;
+    FirmwareImage& operator=(const FirmwareImage&) = delete;
+
+    /**
+     * @brief Map and validate firmware image file
+     *
+     * @param[in] path - firmware image file path
+     * @return shared read-only image
+     * @throw std::runtime_error if the file can't be mapped or it is not a
+     *        valid firmware image
+     */
+    static std::shared_ptr<const FirmwareImage>
+        open(const std::filesystem::path& path);
+
+    const char* data() const
+    {
+        return static_cast<const char*>(mem.data());
+    }
+
+    size_t size() const
+    {
+        return mem.size();
+    }
+
+    const std::filesystem::path& path() const
+    {
+        return filePath;
+    }
+
+    /* Image can't be less than header size */
+    static constexpr size_t headerSize = 64;
+    /* Image can't be more than 128 Kbytes */
+    static constexpr size_t maxSize = 128 * 1024;
+
+  private:
+    FirmwareImage(std::filesystem::path path, common::MappedMem mem) :
+        filePath(std::move(path)), mem(std::move(mem))
+    {}
+
+    std::filesystem::path filePath;
+    common::MappedMem mem;
+};
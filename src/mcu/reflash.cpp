@@ -2,20 +2,30 @@
  * SPDX-License-Identifier: Apache-2.0
  * Copyright (C) 2022, KNS Group LLC (YADRO).
  */
-#include "backplane_mcu_driver.hpp"
-#include "common/mmapfile.hpp"
+#include "reflasher.hpp"
+#include "update_engine.hpp"
 
-#include <gpiod.hpp>
-#include <nlohmann/json.hpp>
+#include <getopt.h>
 
-#include <chrono>
 #include <cstdio>
 #include <filesystem>
-#include <fstream>
+#include <map>
+#include <mutex>
 #include <thread>
 
 namespace fs = std::filesystem;
 
+/**
+ * @brief Result of the single MCU check/reflash
+ */
+enum class ReflashStatus
+{
+    Absent,  //!< MCU not found on the bus
+    Skipped, //!< MCU already runs the required firmware
+    Updated, //!< MCU flashed successfully
+    Failed,  //!< MCU present but reflashing failed
+};
+
 /**
  * @brief Check MCU and reflash if required
  *
@@ -23,16 +33,21 @@ namespace fs = std::filesystem;
  * @param addr     - MCU's i2c address
  * @param force    - Interpret the MCU absence as an error
  * @param firmware - Path to firmware image
+ * @param image    - Firmware image, nullptr if it can't be loaded
  * @param version  - Required frimware version
+ *
+ * @return status of the operation
  */
-static void updateMCU(int bus, int addr, bool force, const fs::path& firmware,
-                      const std::string& version)
+static ReflashStatus updateMCU(int bus, int addr, bool force,
+                               const fs::path& firmware,
+                               const FirmwareImage* image,
+                               const std::string& version)
 {
     std::string dev = "/dev/i2c-" + std::to_string(bus);
-    std::unique_ptr<BackplaneMCUDriver> mcu;
+    std::unique_ptr<MCUUpdateEngine> engine;
     try
     {
-        mcu = backplaneMCU(dev, addr);
+        engine = std::make_unique<MCUUpdateEngine>(dev, addr);
     }
     catch (const std::exception& e)
     {
@@ -40,415 +55,274 @@ static void updateMCU(int bus, int addr, bool force, const fs::path& firmware,
         {
             fprintf(stderr, "MCU_%d_%02X: unable to init, %s\n", bus, addr,
                     e.what());
+            return ReflashStatus::Failed;
         }
-        return;
+        return ReflashStatus::Absent;
     }
 
-    try
-    {
-        auto devType = mcu->getBoardType();
-        auto fwVer = mcu->getFwVersion();
+    printf("MCU_%d_%02X: type='%s', ver='%s'\n", bus, addr,
+           engine->boardType().c_str(), engine->fwVersion().c_str());
 
-        printf("MCU_%d_%02X: type='%s', ver='%s'\n", bus, addr, devType.c_str(),
-               fwVer.c_str());
+    if (!version.empty() && version == engine->fwVersion())
+    {
+        printf("MCU_%d_%02X is running on the same version, reflashing "
+               "skipped.\n",
+               bus, addr);
+        return ReflashStatus::Skipped;
+    }
 
-        if (!version.empty() && version == fwVer)
-        {
-            printf("MCU_%d_%02X is running on the same version, reflashing "
-                   "skipped.\n",
-                   bus, addr);
-            return;
-        }
+    if (firmware.empty())
+    {
+        return ReflashStatus::Skipped;
     }
-    catch (const std::exception& e)
+
+    if (!image)
     {
-        fprintf(stderr, "MCU_%d_%02X: Unable to query, %s\n", bus, addr,
-                e.what());
-        return;
+        fprintf(stderr, "MCU_%d_%02X: Image %s is not valid\n", bus, addr,
+                firmware.c_str());
+        return ReflashStatus::Failed;
     }
 
     try
     {
-        if (!firmware.empty())
-        {
-            auto fw = common::MappedMem::open(firmware);
-
-            static constexpr size_t minImageSize =
-                64; // image can't be less then 64 bytes (header size)
-            static constexpr size_t maxImageSize =
-                128 * 1024; // image can't be more then 128 Kbytes
-            if ((fw.size() < minImageSize) || (fw.size() > maxImageSize))
-            {
-                fprintf(stderr, "Incorrect '%s' size\n", firmware.c_str());
-                return;
-            }
-
-            // NOTE: On some old versions of MCU firmware, this operation may
-            //       lead to full erasing of the MCU flash chip.
-            //       Fortunately, the boot loader on MCU cleans the flash during
-            //       the boot, so this operation can be safely skipped.
-            // mcu->eraseFlash();
-            // std::this_thread::sleep_for(std::chrono::seconds(2));
-
-            static constexpr size_t chunkSize =
-                128; // max chunk size is 255 bytes, but it shall be 4-byte
-                     // aligned
-
-            try
-            {
-                for (size_t offset = 0; offset < fw.size(); offset += chunkSize)
-                {
-                    mcu->writeFlash(reinterpret_cast<char*>(fw.data()) + offset,
-                                    std::min(chunkSize, fw.size() - offset));
-                }
-            }
-            catch (...)
-            {
-                // NOTE: Force MCU reboot to clean up the flash chip.
-                mcu->reboot();
-                throw;
-            }
-
-            bool done = false;
-            mcu->reboot();
-            static constexpr auto numAttempts = 20;
-            for (auto cnt = 0; !done && cnt < numAttempts; ++cnt)
-            {
-                std::this_thread::sleep_for(std::chrono::seconds(1));
-                done = mcu->ping();
-            }
-
-            if (done)
-            {
-                printf("MCU_%d_%02X: Flashed with '%s'\n", bus, addr,
-                       firmware.c_str());
-
-                // create new object since protocol may changed in new firmware
-                try
-                {
-                    mcu = backplaneMCU(dev, addr);
-                    printf("MCU_%d_%02X: After reflash: type='%s', ver='%s'\n",
-                           bus, addr, mcu->getBoardType().c_str(),
-                           mcu->getFwVersion().c_str());
-                }
-                catch (const std::exception& e)
-                {
-                    fprintf(stderr, "MCU_%d_%02X: Unable to requery, %s\n", bus,
-                            addr, e.what());
-                }
-            }
-            else
-            {
-                fprintf(stderr,
-                        "MCU_%d_%02X doesn't bring back after "
-                        "rebooting in %d seconds.\n",
-                        bus, addr, numAttempts);
-            }
-        }
+        // NOTE: On some old versions of MCU firmware, erase-flash operation
+        //       may lead to full erasing of the MCU flash chip.
+        //       Fortunately, the boot loader on MCU cleans the flash during
+        //       the boot, so this operation can be safely skipped.
+        //       The version is verified after the reboot, a mismatch with
+        //       the image version is reported as a failure.
+        engine->flash(*image, version);
     }
     catch (const std::exception& e)
     {
         fprintf(stderr, "MCU_%d_%02X: Unable to flash %s, %s\n", bus, addr,
                 firmware.c_str(), e.what());
+        return ReflashStatus::Failed;
     }
+
+    printf("MCU_%d_%02X: Flashed with '%s', rebooted in %lld ms\n", bus, addr,
+           firmware.c_str(),
+           static_cast<long long>(engine->rebootTime().count()));
+    printf("MCU_%d_%02X: After reflash: type='%s', ver='%s'\n", bus, addr,
+           engine->boardType().c_str(), engine->fwVersion().c_str());
+    return ReflashStatus::Updated;
 }
 
 /**
- * @brief Try to find i2c bus that the gpio chip is located on
- *
- * @param chip - gpio chip
+ * @brief Aggregated progress of the reflash jobs
  *
- * @return i2c bus number
+ * Collects results from all workers and prints the overall progress, so the
+ * output stays readable when several buses are processed simultaneously.
  */
-static int findBus(const std::string& chip)
+class ReflashProgress
 {
-    for (const auto& entry : fs::directory_iterator("/sys/bus/i2c/devices"))
+  public:
+    explicit ReflashProgress(size_t total) : total(total)
+    {}
+
+    void report(int bus, int addr, ReflashStatus status)
     {
-        if (fs::exists(entry.path() / chip))
+        std::lock_guard<std::mutex> lock(mutex);
+        ++done;
+        switch (status)
         {
-            try
-            {
-                // The filename contains bus and addr. For example: 21-0010
-                return std::stoi(entry.path().filename().string());
-            }
-            catch (const std::exception&)
-            {
-                // pass
-            }
+            case ReflashStatus::Absent:
+                ++absent;
+                break;
+            case ReflashStatus::Skipped:
+                ++skipped;
+                break;
+            case ReflashStatus::Updated:
+                ++updated;
+                printf("[%zu/%zu] MCU_%d_%02X: updated\n", done, total, bus,
+                       addr);
+                break;
+            case ReflashStatus::Failed:
+                ++failed;
+                printf("[%zu/%zu] MCU_%d_%02X: FAILED\n", done, total, bus,
+                       addr);
+                break;
         }
     }
-    return -1;
-}
-
-static constexpr size_t numberOfPins = 8;
 
-/**
- * @brief Calculate value encoded by bits
- *
- * NOTE: It uses the reverse format when 0-th bit is the leftmost.
- *
- */
-inline uint8_t calcShred(const std::string& bits)
-{
-    uint8_t value = 0;
-    for (size_t i = 0; i < bits.size() && i < numberOfPins; ++i)
+    /**
+     * @brief Print summary
+     *
+     * @return true if no one MCU failed
+     */
+    bool summary() const
     {
-        if (bits[i] == '0' || bits[i] == '1')
-        {
-            value |= ((bits[i] - '0') << (numberOfPins - 1 - i));
-        }
-        else
-        {
-            fprintf(stderr, "Incorrect bit value in '%s' at %zu position\n",
-                    bits.c_str(), i);
-            return static_cast<uint8_t>(-1);
-        }
+        std::lock_guard<std::mutex> lock(mutex);
+        printf("Reflash done: %zu updated, %zu up to date, %zu failed, "
+               "%zu not found\n",
+               updated, skipped, failed, absent);
+        return failed == 0;
     }
 
-    return value;
-}
+  private:
+    mutable std::mutex mutex;
+    size_t total;
+    size_t done = 0;
+    size_t absent = 0;
+    size_t skipped = 0;
+    size_t updated = 0;
+    size_t failed = 0;
+};
 
 /**
- * @brief Convert bit values to string format
+ * @brief Single MCU check/reflash request
  */
-inline std::string toString(const std::vector<int>& bits)
+struct Job
 {
-    std::string ret;
-    ret.reserve(bits.size() + 1);
-    for (const auto& bit : bits)
-    {
-        ret.push_back('0' + (bit & 0x01));
-    }
-    return ret;
-}
+    int addr;
+    bool force;
+    fs::path firmware;
+    std::shared_ptr<const FirmwareImage> image;
+    std::string version;
+};
+using JobList = std::vector<Job>;
 
 /**
- * @brief Compare key with wildcards and read shred value
+ * @brief Search all MCUs and try to update them
+ *
+ * MCUs located on the same i2c-bus are always processed one by one, but
+ * different buses are served by own worker threads if \p parallel is set.
  *
- * @param key  - key value
- * @param bits - shred real value
+ * @param reflasher - reflasher with loaded configuration
+ * @param parallel  - process different i2c-buses simultaneously
  *
- * @return true if matched
+ * @return true if all found MCUs are up to date
  */
-static bool compareShred(const std::string& key, const std::string& bits)
+static bool scan(Reflasher& reflasher, bool parallel)
 {
-    const size_t keySz = key.length();
-    const size_t bitsSz = bits.length();
-    if (keySz != bitsSz)
-    {
-        return false;
-    }
-
-    for (size_t i = 0; i < keySz; ++i)
+    std::map<int, JobList> jobs;
+    std::map<fs::path, std::shared_ptr<const FirmwareImage>> images;
+    size_t total = 0;
+    for (const auto& target : reflasher.findTargets())
     {
-        if (key[i] != '*' && key[i] != bits[i])
-        {
-            return false;
-        }
-    }
-
-    return true;
-}
+        const auto& fwPath = target.firmware;
 
-class Reflasher
-{
-    using Definition = std::tuple<fs::path, std::string, std::vector<int>>;
-    using Shred = std::tuple<std::string, std::string, int>;
-    using ShredList = std::vector<Shred>;
+        printf("Found shred '%s' (0x%02X), chip='%s', bus=i2c-%d, fw=%s\n",
+               target.shred.c_str(), calcShred(target.shred),
+               target.chip.c_str(), target.bus,
+               fwPath.empty() ? "N/A" : fwPath.filename().c_str());
 
-  public:
-    /**
-     * @brief Load configuration
-     *
-     * @param path - path to config file
-     */
-    void loadConfig(const fs::path& path)
-    {
-        try
+        // each image is mapped and validated once and then shared by all
+        // the MCUs it targets
+        std::shared_ptr<const FirmwareImage> image;
+        if (!fwPath.empty())
         {
-            std::ifstream is(path);
-            auto json = nlohmann::json::parse(is);
-
-            static constexpr auto shred = "shred";
-
-            if (json.is_object() && json.contains(shred) &&
-                json[shred].is_object())
+            auto it = images.find(fwPath);
+            if (it == images.end())
             {
-                for (const auto& [key, info] : json[shred].items())
+                try
                 {
-                    static constexpr auto firmware = "firmware";
-                    static constexpr auto version = "version";
-                    static constexpr auto mcus = "mcus";
-
-                    fs::path fwPath;
-                    if (info.contains(firmware))
-                    {
-                        const auto& fwName = info[firmware].get<std::string>();
-                        fwPath = path.parent_path() / fwName;
-                        if (!fs::exists(fwPath))
-                        {
-                            fprintf(stderr,
-                                    "Definition '%s': Image '%s' "
-                                    "doesn't exists!\n",
-                                    key.c_str(), fwName.c_str());
-                            fwPath.clear();
-                        }
-                    }
-
-                    auto fwVer = info.contains(version)
-                                     ? info[version].get<std::string>()
-                                     : "";
-                    std::vector<int> mcuAddrs;
-
-                    if (info.contains(mcus) && info[mcus].is_array())
-                    {
-                        for (const auto& addr : info[mcus])
-                        {
-                            mcuAddrs.emplace_back(addr.get<int>());
-                        }
-                    }
-
-                    definitions.emplace(
-                        key, std::make_tuple(fwPath, fwVer, mcuAddrs));
+                    image = FirmwareImage::open(fwPath);
+                }
+                catch (const std::exception& e)
+                {
+                    fprintf(stderr, "Unable to load '%s', %s\n",
+                            fwPath.c_str(), e.what());
                 }
+                images.emplace(fwPath, image);
+            }
+            else
+            {
+                image = it->second;
             }
         }
-        catch (const std::exception& e)
+
+        auto& busJobs = jobs[target.bus];
+        for (const auto& addr : target.addrs)
         {
-            fprintf(stderr, "Load '%s' failed, %s\n", path.c_str(), e.what());
-            definitions.clear();
+            busJobs.push_back(
+                {addr, target.required, fwPath, image, target.version});
         }
+        total += target.addrs.size();
     }
 
-    /**
-     * @brief Search all MCUs and try to update them
-     */
-    void scan(void)
-    {
-        for (const auto& [shred, chip, bus] : findShreds())
+    ReflashProgress progress(total);
+    auto worker = [&progress](int bus, const JobList& busJobs) {
+        for (const auto& job : busJobs)
         {
-            const auto& [fwPath, fwVersion, mcuAddrs] = findDefinition(shred);
-
-            printf("Found shred '%s' (0x%02X), chip='%s', bus=i2c-%d, fw=%s\n",
-                   shred.c_str(), calcShred(shred), chip.c_str(), bus,
-                   fwPath.empty() ? "N/A" : fwPath.filename().c_str());
-
-            for (const auto& addr : mcuAddrs)
-            {
-                updateMCU(bus, addr, true, fwPath, fwVersion);
-            }
-
-            if (mcuAddrs.empty())
-            {
-                // Try to scan all possible addresses
-                for (const auto& addr : {0x2a, 0x2b, 0x2c})
-                {
-                    updateMCU(bus, addr, false, fwPath, fwVersion);
-                }
-            }
+            progress.report(bus, job.addr,
+                            updateMCU(bus, job.addr, job.force, job.firmware,
+                                      job.image.get(), job.version));
         }
-    }
+    };
 
-  protected:
-    /**
-     * @brief Find definition brought by config file.
-     *
-     * @param shred - shred bits in string format
-     */
-    const Definition& findDefinition(const std::string& shred) const
+    if (parallel && jobs.size() > 1)
     {
-        for (const auto& [name, def] : definitions)
+        std::vector<std::thread> workers;
+        workers.reserve(jobs.size());
+        for (const auto& [bus, busJobs] : jobs)
         {
-            if (compareShred(name, shred))
-            {
-                return def;
-            }
+            workers.emplace_back(worker, bus, std::cref(busJobs));
+        }
+        for (auto& thread : workers)
+        {
+            thread.join();
         }
-
-        static Definition empty;
-        return empty;
     }
-
-    /**
-     * @brief Find shred through all GPIO lines
-     *
-     * @return List of shred bits and i2c-bus where it's located.
-     */
-    ShredList findShreds(void)
+    else
     {
-        ShredList shreds;
-
-        for (const auto& chip : gpiod::make_chip_iter())
+        for (const auto& [bus, busJobs] : jobs)
         {
-            gpiod::line_bulk bulk;
-            for (const auto& line : gpiod::line_iter(chip))
-            {
-                if (line.name().find("_SHRED_") != std::string::npos)
-                {
-                    bulk.append(line);
-                }
-            }
-
-            if (bulk.empty())
-            {
-                continue;
-            }
-
-            if (bulk.size() != numberOfPins)
-            {
-                fprintf(stderr, "On chip '%s' found %d/%zu items.\n",
-                        chip.name().c_str(), bulk.size(), numberOfPins);
-                continue;
-            }
-
-            std::vector<int> bits;
-            try
-            {
-                static const gpiod::line_request req{
-                    "yadro-mcu-reflash", gpiod::line_request::DIRECTION_INPUT,
-                    0};
-                bulk.request(req);
-                bits = bulk.get_values();
-                bulk.release();
-            }
-            catch (const std::exception& e)
-            {
-                fprintf(stderr, "Unable to get values from %s pins, %s\n",
-                        chip.name().c_str(), e.what());
-                continue;
-            }
-
-            int bus = findBus(chip.name());
-            auto strBits = toString(bits);
-
-            if (bus < 0)
-            {
-                fprintf(stderr,
-                        "Shred '%s' found at '%s', but no i2c-bus determined\n",
-                        strBits.c_str(), chip.name().c_str());
-                continue;
-            }
-
-            shreds.emplace_back(std::make_tuple(strBits, chip.name(), bus));
+            worker(bus, busJobs);
         }
-
-        return shreds;
     }
 
-  private:
-    std::map<std::string, Definition> definitions;
-};
+    return progress.summary();
+}
+
+/**
+ * @brief Show help message
+ *
+ * @param app       application name
+ */
+static void showUsage(const char* app)
+{
+    fprintf(stderr, R"(
+Usage: %s [-p] [<config>]
+    Detect backplanes and reflash their MCUs if required.
+Options:
+  -p, --parallel            Reflash MCUs on different I2C buses
+                            simultaneously.
+  -h, --help                Show this help.
+)",
+            app);
+}
 
-int main([[maybe_unused]] int argc, [[maybe_unused]] char* argv[])
+int main(int argc, char* argv[])
 {
     Reflasher reflasher;
-
-    if (argc > 1)
+    bool parallel = false;
+
+    const struct option opts[] = {{"parallel", no_argument, nullptr, 'p'},
+                                  {"help", no_argument, nullptr, 'h'},
+                                  // --- end of array ---
+                                  {nullptr, 0, nullptr, '\0'}};
+    int c;
+    while ((c = getopt_long(argc, argv, "ph", opts, nullptr)) != -1)
     {
-        reflasher.loadConfig(argv[1]);
+        switch (c)
+        {
+            case 'p':
+                parallel = true;
+                break;
+            case 'h':
+                showUsage(argv[0]);
+                return EXIT_SUCCESS;
+            default:
+                showUsage(argv[0]);
+                return EXIT_FAILURE;
+        }
     }
 
-    reflasher.scan();
+    if (optind < argc)
+    {
+        reflasher.loadConfig(argv[optind]);
+    }
 
-    return 0;
+    return scan(reflasher, parallel) ? EXIT_SUCCESS : EXIT_FAILURE;
 }
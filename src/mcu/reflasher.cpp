@@ -0,0 +1,269 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (C) 2022, KNS Group LLC (YADRO).
+ */
+
+#include "reflasher.hpp"
+
+#include <gpiod.hpp>
+#include <nlohmann/json.hpp>
+#include <phosphor-logging/log.hpp>
+
+#include <fstream>
+
+namespace fs = std::filesystem;
+using namespace phosphor::logging;
+
+static constexpr size_t numberOfPins = 8;
+
+/**
+ * @brief Try to find i2c bus that the gpio chip is located on
+ *
+ * @param chip - gpio chip
+ *
+ * @return i2c bus number
+ */
+static int findBus(const std::string& chip)
+{
+    for (const auto& entry : fs::directory_iterator("/sys/bus/i2c/devices"))
+    {
+        if (fs::exists(entry.path() / chip))
+        {
+            try
+            {
+                // The filename contains bus and addr. For example: 21-0010
+                return std::stoi(entry.path().filename().string());
+            }
+            catch (const std::exception&)
+            {
+                // pass
+            }
+        }
+    }
+    return -1;
+}
+
+uint8_t calcShred(const std::string& bits)
+{
+    uint8_t value = 0;
+    for (size_t i = 0; i < bits.size() && i < numberOfPins; ++i)
+    {
+        if (bits[i] == '0' || bits[i] == '1')
+        {
+            value |= ((bits[i] - '0') << (numberOfPins - 1 - i));
+        }
+        else
+        {
+            log<level::ERR>("Incorrect shred bit value",
+                            entry("SHRED=%s", bits.c_str()),
+                            entry("POSITION=%zu", i));
+            return static_cast<uint8_t>(-1);
+        }
+    }
+
+    return value;
+}
+
+/**
+ * @brief Convert bit values to string format
+ */
+static std::string toString(const std::vector<int>& bits)
+{
+    std::string ret;
+    ret.reserve(bits.size() + 1);
+    for (const auto& bit : bits)
+    {
+        ret.push_back('0' + (bit & 0x01));
+    }
+    return ret;
+}
+
+/**
+ * @brief Compare key with wildcards and read shred value
+ *
+ * @param key  - key value
+ * @param bits - shred real value
+ *
+ * @return true if matched
+ */
+static bool compareShred(const std::string& key, const std::string& bits)
+{
+    const size_t keySz = key.length();
+    const size_t bitsSz = bits.length();
+    if (keySz != bitsSz)
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < keySz; ++i)
+    {
+        if (key[i] != '*' && key[i] != bits[i])
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void Reflasher::loadConfig(const fs::path& path)
+{
+    try
+    {
+        std::ifstream is(path);
+        auto json = nlohmann::json::parse(is);
+
+        static constexpr auto shred = "shred";
+
+        if (json.is_object() && json.contains(shred) &&
+            json[shred].is_object())
+        {
+            for (const auto& [key, info] : json[shred].items())
+            {
+                static constexpr auto firmware = "firmware";
+                static constexpr auto version = "version";
+                static constexpr auto mcus = "mcus";
+
+                fs::path fwPath;
+                if (info.contains(firmware))
+                {
+                    const auto& fwName = info[firmware].get<std::string>();
+                    fwPath = path.parent_path() / fwName;
+                    if (!fs::exists(fwPath))
+                    {
+                        log<level::ERR>("Firmware image doesn't exist",
+                                        entry("DEFINITION=%s", key.c_str()),
+                                        entry("IMAGE=%s", fwName.c_str()));
+                        fwPath.clear();
+                    }
+                }
+
+                auto fwVer = info.contains(version)
+                                 ? info[version].get<std::string>()
+                                 : "";
+                std::vector<int> mcuAddrs;
+
+                if (info.contains(mcus) && info[mcus].is_array())
+                {
+                    for (const auto& addr : info[mcus])
+                    {
+                        mcuAddrs.emplace_back(addr.get<int>());
+                    }
+                }
+
+                definitions.emplace(key,
+                                    std::make_tuple(fwPath, fwVer, mcuAddrs));
+            }
+        }
+    }
+    catch (const std::exception& e)
+    {
+        log<level::ERR>("Failed to load reflash configuration",
+                        entry("FILE=%s", path.c_str()),
+                        entry("REASON=%s", e.what()));
+        definitions.clear();
+    }
+}
+
+std::vector<ReflashTarget> Reflasher::findTargets()
+{
+    std::vector<ReflashTarget> targets;
+    for (const auto& [shred, chip, bus] : findShreds())
+    {
+        const auto& [fwPath, fwVersion, mcuAddrs] = findDefinition(shred);
+
+        ReflashTarget target;
+        target.shred = shred;
+        target.chip = chip;
+        target.bus = bus;
+        target.firmware = fwPath;
+        target.version = fwVersion;
+        target.addrs = mcuAddrs;
+        target.required = !mcuAddrs.empty();
+        if (mcuAddrs.empty())
+        {
+            // Try to scan all possible addresses
+            target.addrs = {0x2a, 0x2b, 0x2c};
+        }
+        targets.push_back(std::move(target));
+    }
+    return targets;
+}
+
+const Reflasher::Definition&
+    Reflasher::findDefinition(const std::string& shred) const
+{
+    for (const auto& [name, def] : definitions)
+    {
+        if (compareShred(name, shred))
+        {
+            return def;
+        }
+    }
+
+    static Definition empty;
+    return empty;
+}
+
+Reflasher::ShredList Reflasher::findShreds(void)
+{
+    ShredList shreds;
+
+    for (const auto& chip : gpiod::make_chip_iter())
+    {
+        gpiod::line_bulk bulk;
+        for (const auto& line : gpiod::line_iter(chip))
+        {
+            if (line.name().find("_SHRED_") != std::string::npos)
+            {
+                bulk.append(line);
+            }
+        }
+
+        if (bulk.empty())
+        {
+            continue;
+        }
+
+        if (bulk.size() != numberOfPins)
+        {
+            log<level::ERR>("Unexpected number of shred pins",
+                            entry("CHIP=%s", chip.name().c_str()),
+                            entry("FOUND=%u", bulk.size()),
+                            entry("EXPECTED=%zu", numberOfPins));
+            continue;
+        }
+
+        std::vector<int> bits;
+        try
+        {
+            static const gpiod::line_request req{
+                "yadro-mcu-reflash", gpiod::line_request::DIRECTION_INPUT, 0};
+            bulk.request(req);
+            bits = bulk.get_values();
+            bulk.release();
+        }
+        catch (const std::exception& e)
+        {
+            log<level::ERR>("Unable to get shred pins values",
+                            entry("CHIP=%s", chip.name().c_str()),
+                            entry("REASON=%s", e.what()));
+            continue;
+        }
+
+        int bus = findBus(chip.name());
+        auto strBits = toString(bits);
+
+        if (bus < 0)
+        {
+            log<level::ERR>("Shred found, but no i2c-bus determined",
+                            entry("SHRED=%s", strBits.c_str()),
+                            entry("CHIP=%s", chip.name().c_str()));
+            continue;
+        }
+
+        shreds.emplace_back(std::make_tuple(strBits, chip.name(), bus));
+    }
+
+    return shreds;
+}
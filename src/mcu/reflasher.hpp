@@ -0,0 +1,86 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (C) 2022, KNS Group LLC (YADRO).
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
+
+/**
+ * @brief Backplane detected by its shred and the firmware it requires
+ */
+struct ReflashTarget
+{
+    std::string shred;              //!< shred bits in string format
+    std::string chip;               //!< GPIO chip the shred is read from
+    int bus;                        //!< I2C bus the backplane is located on
+    std::filesystem::path firmware; //!< firmware image, empty if not defined
+    std::string version;            //!< required firmware version
+    std::vector<int> addrs;         //!< MCU I2C addresses
+    bool required;                  //!< whether MCU absence is an error
+};
+
+/**
+ * @brief Calculate value encoded by shred bits
+ *
+ * NOTE: It uses the reverse format when 0-th bit is the leftmost.
+ */
+uint8_t calcShred(const std::string& bits);
+
+/**
+ * @class Reflasher
+ *
+ * This class detects backplanes by the shred GPIO lines and finds the
+ * firmware they require according to the configuration file. It is shared by
+ * the standalone reflash tool and the storage manager, which reflashes MCUs in
+ * the background.
+ */
+class Reflasher
+{
+    using Definition =
+        std::tuple<std::filesystem::path, std::string, std::vector<int>>;
+    using Shred = std::tuple<std::string, std::string, int>;
+    using ShredList = std::vector<Shred>;
+
+  public:
+    /**
+     * @brief Load configuration
+     *
+     * @param path - path to config file
+     */
+    void loadConfig(const std::filesystem::path& path);
+
+    /**
+     * @brief Detect backplanes and find the firmware they require
+     *
+     * If the configuration doesn't define MCU addresses for the backplane,
+     * all the possible addresses are listed and the target is not required.
+     *
+     * @return list of detected backplanes
+     */
+    std::vector<ReflashTarget> findTargets();
+
+  protected:
+    /**
+     * @brief Find definition brought by config file.
+     *
+     * @param shred - shred bits in string format
+     */
+    const Definition& findDefinition(const std::string& shred) const;
+
+    /**
+     * @brief Find shred through all GPIO lines
+     *
+     * @return List of shred bits and i2c-bus where it's located.
+     */
+    ShredList findShreds(void);
+
+  private:
+    std::map<std::string, Definition> definitions;
+};
@@ -0,0 +1,175 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (C) 2022, KNS Group LLC (YADRO)
+ */
+
+#include "update_engine.hpp"
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <filesystem>
+#include <thread>
+
+/* Max chunk size is 255 bytes, but it shall be 4-byte aligned */
+static constexpr size_t chunkSize = 128;
+/* Directory for I2C bus lock files */
+static constexpr const char* lockDir = "/run/lock";
+/* Interval of the I2C bus lock polling */
+static constexpr std::chrono::milliseconds lockPollDelay{100};
+
+/**
+ * @brief Exclusive advisory lock of the I2C bus used for firmware update
+ */
+class BusLock
+{
+  public:
+    BusLock(const BusLock&) = delete;
+    BusLock& operator=(const BusLock&) = delete;
+
+    /**
+     * @brief Constructor, takes the lock
+     *
+     * @param[in] devPath - I2C bus device file path
+     * @param[in] wait - wait for another update to release the bus instead of
+     *                   failing
+     * @param[in] cancelled - flag to stop waiting, may be nullptr
+     * @throw std::runtime_error if the bus is locked by another update and
+     *        waiting is not requested, UpdateCancelled if waiting is stopped
+     */
+    explicit BusLock(const std::string& devPath, bool wait = false,
+                     const std::atomic_bool* cancelled = nullptr)
+    {
+        const std::string lockFile =
+            std::string(lockDir) + "/yadro-mcu-update-" +
+            std::filesystem::path(devPath).filename().string() + ".lock";
+        fd = open(lockFile.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (fd < 0)
+        {
+            throw std::runtime_error("Failed to open " + lockFile + ": " +
+                                     std::strerror(errno));
+        }
+        // the lock is polled, so the waiting can be cancelled
+        while (flock(fd, LOCK_EX | LOCK_NB) < 0)
+        {
+            const int err = errno;
+            if (err == EWOULDBLOCK && wait)
+            {
+                if (cancelled && *cancelled)
+                {
+                    close(fd);
+                    throw UpdateCancelled();
+                }
+                std::this_thread::sleep_for(lockPollDelay);
+                continue;
+            }
+            close(fd);
+            if (err == EWOULDBLOCK)
+            {
+                throw std::runtime_error("I2C bus " + devPath +
+                                         " is busy with another update");
+            }
+            throw std::runtime_error("Failed to lock " + lockFile + ": " +
+                                     std::strerror(err));
+        }
+    }
+
+    ~BusLock()
+    {
+        close(fd);
+    }
+
+  private:
+    int fd;
+};
+
+MCUUpdateEngine::MCUUpdateEngine(std::string devPath, int addr,
+                                 const std::atomic_bool* cancelled) :
+    devPath(std::move(devPath)),
+    addr(addr)
+{
+    // the MCU may be in the middle of an update started by another process,
+    // so it is probed only once the bus is released
+    BusLock lock(this->devPath, true, cancelled);
+    mcu = backplaneMCU(this->devPath, addr);
+    type = mcu->getBoardType();
+    version = mcu->getFwVersion();
+}
+
+void MCUUpdateEngine::eraseFlash()
+{
+    mcu->eraseFlash();
+    std::this_thread::sleep_for(std::chrono::seconds(2));
+    erased = true;
+}
+
+void MCUUpdateEngine::flash(const FirmwareImage& image,
+                            const std::string& expectedVersion)
+{
+    const char* data = image.data();
+    const size_t size = image.size();
+
+    if (cancelled)
+    {
+        throw UpdateCancelled();
+    }
+
+    BusLock lock(devPath);
+    const auto writeStart = std::chrono::steady_clock::now();
+    try
+    {
+        for (size_t offset = 0; offset < size; offset += chunkSize)
+        {
+            if (cancelled)
+            {
+                throw UpdateCancelled();
+            }
+            const size_t bytes = std::min(chunkSize, size - offset);
+            mcu->writeFlash(data + offset, bytes);
+            if (progress)
+            {
+                progress(offset + bytes, size);
+            }
+        }
+    }
+    catch (...)
+    {
+        if (!erased)
+        {
+            // NOTE: Enforces the MCU's boot loader to clean the flash up.
+            mcu->reboot();
+        }
+        throw;
+    }
+    writeDuration = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - writeStart);
+
+    mcu->reboot();
+    // create new object since protocol may changed in new firmware
+    mcu = backplaneMCUWaitReady(devPath, addr, type, rebootTimeout,
+                                rebootDuration, &cancelled);
+    if (!mcu && cancelled)
+    {
+        // the image is written completely, the MCU boots it anyway
+        throw UpdateCancelled();
+    }
+    if (!mcu)
+    {
+        throw std::runtime_error("MCU is not responding after reboot");
+    }
+
+    type = mcu->getBoardType();
+    version = mcu->getFwVersion();
+    if (version.empty() || type.empty())
+    {
+        throw std::runtime_error("Can not read device information");
+    }
+    if (!expectedVersion.empty() && version != expectedVersion)
+    {
+        throw std::runtime_error("Firmware version mismatched: expected '" +
+                                 expectedVersion + "', read '" + version +
+                                 "'");
+    }
+}
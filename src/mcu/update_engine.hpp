@@ -0,0 +1,138 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (C) 2022, KNS Group LLC (YADRO)
+ */
+
+#pragma once
+
+#include "backplane_mcu_driver.hpp"
+#include "firmware_image.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <stdexcept>
+#include <string>
+
+/**
+ * @brief Exception thrown when firmware update was cancelled
+ */
+class UpdateCancelled : public std::runtime_error
+{
+  public:
+    UpdateCancelled() : std::runtime_error("Firmware update cancelled")
+    {}
+};
+
+/**
+ * @class MCUUpdateEngine
+ *
+ * This class implements backplane MCU firmware update pipeline: the image is
+ * written to MCU flash chunk by chunk, then MCU is rebooted and the new
+ * firmware is verified. The engine is shared by the standalone tools and the
+ * storage manager, which runs it in a worker thread.
+ */
+class MCUUpdateEngine
+{
+  public:
+    /** @brief Progress handler, receives number of written and total bytes */
+    using ProgressHandler = std::function<void(size_t, size_t)>;
+
+    MCUUpdateEngine(const MCUUpdateEngine&) = delete;
+    MCUUpdateEngine& operator=(const MCUUpdateEngine&) = delete;
+    MCUUpdateEngine(MCUUpdateEngine&&) = delete;
+    MCUUpdateEngine& operator=(MCUUpdateEngine&&) = delete;
+
+    /**
+     * @brief Constructor
+     *
+     * The constructor detects MCU protocol and reads current firmware
+     * information. The I2C bus lock is held meanwhile, so an update running on
+     * the bus is waited for.
+     * @param[in] devPath - I2C bus device file path (e.g. "/dev/i2c-20")
+     * @param[in] addr - 7-bit I2C device address
+     * @param[in] cancelled - flag to stop waiting for the bus, may be nullptr
+     * @throw std::runtime_error if MCU is not accessible, UpdateCancelled if
+     *        waiting for the bus is stopped
+     */
+    MCUUpdateEngine(std::string devPath, int addr,
+                    const std::atomic_bool* cancelled = nullptr);
+
+    /** @brief Board type reported by MCU */
+    const std::string& boardType() const
+    {
+        return type;
+    }
+
+    /** @brief Firmware version reported by MCU */
+    const std::string& fwVersion() const
+    {
+        return version;
+    }
+
+    /** @brief Time taken to write the image to MCU flash */
+    std::chrono::milliseconds writeTime() const
+    {
+        return writeDuration;
+    }
+
+    /** @brief Time taken by MCU to boot the new firmware */
+    std::chrono::milliseconds rebootTime() const
+    {
+        return rebootDuration;
+    }
+
+    /**
+     * @brief Set handler to be called after each written chunk
+     *
+     * @note The handler is called from the thread running flash().
+     */
+    void setProgressHandler(ProgressHandler handler)
+    {
+        progress = std::move(handler);
+    }
+
+    /**
+     * @brief Request update cancellation
+     *
+     * May be called from any thread. The update is interrupted before the
+     * next chunk is written or while waiting for MCU to reboot.
+     */
+    void cancel()
+    {
+        cancelled = true;
+    }
+
+    /**
+     * @brief Send erase-flash command to MCU
+     */
+    void eraseFlash();
+
+    /**
+     * @brief Write the image to MCU and boot the new firmware
+     *
+     * The I2C bus is locked for the whole operation, so concurrent updates
+     * of the MCUs on the same bus (even from other processes) fail fast
+     * instead of interleaving the transfers.
+     *
+     * @param[in] image - validated firmware image
+     * @param[in] expectedVersion - version of the new firmware, the check is
+     *                              skipped if empty
+     * @throw UpdateCancelled if cancelled, std::runtime_error on failures
+     */
+    void flash(const FirmwareImage& image, const std::string& expectedVersion);
+
+    static constexpr std::chrono::seconds rebootTimeout{20};
+
+  private:
+    std::string devPath;
+    int addr;
+    std::unique_ptr<BackplaneMCUDriver> mcu;
+    std::string type;
+    std::string version;
+    bool erased = false;
+    std::atomic_bool cancelled = false;
+    ProgressHandler progress;
+    std::chrono::milliseconds writeDuration{0};
+    std::chrono::milliseconds rebootDuration{0};
+};
@@ -3,16 +3,12 @@
  * Copyright (C) 2022 YADRO.
  */
 
-#include "backplane_mcu_driver.hpp"
 #include "dbus.hpp"
+#include "update_engine.hpp"
 
 #include <getopt.h>
 #include <unistd.h>
 
-#include <filesystem>
-#include <fstream>
-#include <thread>
-
 #define EXIT_UPDATE_FAILED 10
 static bool showProgress = false;
 static bool forceErase = false;
@@ -41,9 +37,7 @@ bool runImageUpdate(std::string& imagePath, std::string& i2cBusDev, int i2cAddr,
     {
         printf("Using MCU at %s, addr 0x%02X\n", i2cBusDev.c_str(), i2cAddr);
 
-        auto mcu = backplaneMCU(i2cBusDev, i2cAddr);
-        auto fwVer = mcu->getFwVersion();
-        auto devType = mcu->getBoardType();
+        MCUUpdateEngine engine(i2cBusDev, i2cAddr);
         if (showProgress)
         {
 
@@ -51,7 +45,7 @@ bool runImageUpdate(std::string& imagePath, std::string& i2cBusDev, int i2cAddr,
   Device type:              %s
   Current firmware version: %s
 )",
-                    devType.c_str(), fwVer.c_str());
+                    engine.boardType().c_str(), engine.fwVersion().c_str());
         }
 
         if (forceErase)
@@ -60,8 +54,7 @@ bool runImageUpdate(std::string& imagePath, std::string& i2cBusDev, int i2cAddr,
             {
                 fprintf(stdout, "Erase MCU fw update flash area...\n");
             }
-            mcu->eraseFlash();
-            std::this_thread::sleep_for(std::chrono::seconds(2));
+            engine.eraseFlash();
         }
 
         if (imagePath.empty())
@@ -69,24 +62,7 @@ bool runImageUpdate(std::string& imagePath, std::string& i2cBusDev, int i2cAddr,
             return true;
         }
 
-        size_t imageSize = std::filesystem::file_size(imagePath);
-        static constexpr size_t minImageSize =
-            64; // image can't be less then 64 bytes (header size)
-        static constexpr size_t maxImageSize =
-            128 * 1024; // image can't be more then 128 Kbytes
-        if ((imageSize < minImageSize) || (imageSize > maxImageSize))
-        {
-            fprintf(stderr, "Incorrect firmware image size: %d bytes\n",
-                    imageSize);
-            return false;
-        }
-        std::ifstream file(imagePath, std::ios::binary);
-        if (!file.good())
-        {
-            fprintf(stderr, "Failed to open firmware file: %s\n",
-                    imagePath.c_str());
-            return false;
-        }
+        auto image = FirmwareImage::open(imagePath);
         if (showProgress)
         {
 
@@ -95,76 +71,24 @@ bool runImageUpdate(std::string& imagePath, std::string& i2cBusDev, int i2cAddr,
   Firmware image path:      %s
 )",
                     expectedVersion.c_str(), imagePath.c_str());
-        }
 
-        static constexpr size_t chunkSize =
-            128; // max chunk size is 255 bytes, but it shall be 4-byte aligned
-        std::array<char, chunkSize> buf;
-        size_t bytesRead = 0;
-        try
-        {
-            while (file.good() && !file.eof())
-            {
-                file.read(buf.data(), buf.size());
-                size_t bytes = file.gcount();
-                if (bytes == 0)
-                {
-                    break;
-                }
-                mcu->writeFlash(buf.data(), bytes);
-                bytesRead += bytes;
-                float progress = (bytesRead * 100.0) / imageSize;
-                if (showProgress)
-                {
-                    fprintf(stdout,
-                            "wrote %.2f%% (%d of %d bytes, chunk size %d)\n",
-                            progress, bytesRead, imageSize, bytes);
-                }
-            }
-        }
-        catch (...)
-        {
-            if (!forceErase)
-            {
-                // NOTE: Enforces the MCU's boot loader to clean the flash up.
-                mcu->reboot();
-            }
-            throw;
+            engine.setProgressHandler([](size_t written, size_t total) {
+                fprintf(stdout, "wrote %.2f%% (%zu of %zu bytes)\n",
+                        (written * 100.0) / total, written, total);
+            });
         }
 
-        mcu->reboot();
-        for (int cnt = 0; cnt < 20; cnt++)
-        {
-            std::this_thread::sleep_for(std::chrono::seconds(1));
-            if (mcu->ping())
-            {
-                break;
-            }
-        }
-        // create new object since protocol may changed in new firmware
-        mcu = backplaneMCU(i2cBusDev, i2cAddr);
-        fwVer = mcu->getFwVersion();
-        devType = mcu->getBoardType();
+        engine.flash(*image, expectedVersion);
 
         if (showProgress)
         {
+            fprintf(stdout, "MCU rebooted in %lld ms\n",
+                    static_cast<long long>(engine.rebootTime().count()));
             fprintf(stdout, R"(
   Device type:              %s
   Firmware version:         %s
 )",
-                    devType.c_str(), fwVer.c_str());
-        }
-        if (fwVer.empty() || devType.empty())
-        {
-            fprintf(stderr, "Can not read device information\n");
-            return false;
-        }
-        if ((!expectedVersion.empty()) && (fwVer != expectedVersion))
-        {
-            fprintf(stderr,
-                    "Firmware version mismatched: expected '%s', read '%s'\n",
-                    expectedVersion.c_str(), fwVer.c_str());
-            return false;
+                    engine.boardType().c_str(), engine.fwVersion().c_str());
         }
 
         /// TODO: add cleanup (software objects removal) to software manager
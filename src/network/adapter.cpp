@@ -28,16 +28,30 @@ NetworkAdapter::NetworkAdapter(sdbusplus::bus::bus& bus,
     DecoratorAssetServer(bus, dbusEscape(inventoryPath + name).c_str()),
     OperationalStatusServer(bus, dbusEscape(inventoryPath + name).c_str())
 {
-    // try to render adapter manufacturer/model (use pci.ids database)
-    auto [vendorName, modelName] = pciLookup(vendor, device);
     // xyz.openbmc_project.Inventory.Item
     prettyName(name);
     present(true);
+    update(vendor, device, macAddress);
+    // xyz.openbmc_project.State.Decorator.OperationalStatus
+    functional(true);
+}
+
+/**
+ * @brief Update adapter properties, only the changed ones are signaled
+ *
+ * @param[in] vendor - PCI vendor ID
+ * @param[in] device - PCI device ID
+ * @param[in] macAddress - adapter MAC address
+ */
+void NetworkAdapter::update(const std::string& vendor,
+                            const std::string& device,
+                            const std::string& macAddress)
+{
+    // try to render adapter manufacturer/model (use pci.ids database)
+    auto [vendorName, modelName] = pciLookup(vendor, device);
     // xyz.openbmc_project.Inventory.Item.NetworkInterface
     mACAddress(macAddress);
     // xyz.openbmc_project.Inventory.Decorator.Asset
     manufacturer(vendorName);
     model(modelName);
-    // xyz.openbmc_project.State.Decorator.OperationalStatus
-    functional(true);
 }
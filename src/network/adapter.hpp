@@ -31,6 +31,9 @@ struct NetworkAdapter :
                    const std::string& vendor, const std::string& device,
                    const std::string& macAddress);
 
+    void update(const std::string& vendor, const std::string& device,
+                const std::string& macAddress);
+
   private:
     static const std::string inventoryPath;
 };
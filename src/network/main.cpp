@@ -4,13 +4,19 @@
  */
 
 #include "com/yadro/Inventory/Manager/server.hpp"
+#include "common/file_watcher.hpp"
 #include "dbus.hpp"
 #include "adapter.hpp"
 
 #include <phosphor-logging/log.hpp>
 #include <sdbusplus/server.hpp>
+#include <sdeventplus/event.hpp>
 
+#include <filesystem>
 #include <fstream>
+#include <map>
+#include <memory>
+#include <set>
 #include <streambuf>
 #include <string>
 
@@ -27,16 +33,31 @@ using NetworkAdapterManagerServer = sdbusplus::server::object_t<
 class Manager : NetworkAdapterManagerServer
 {
   public:
-    Manager(sdbusplus::bus::bus& bus) :
-        NetworkAdapterManagerServer(bus, dbus::netadpmgr::path), bus(bus)
-    {}
+    Manager(sdbusplus::bus::bus& bus, const sdeventplus::Event& event);
     void rescan();
 
   private:
     sdbusplus::bus::bus& bus;
-    std::vector<std::shared_ptr<NetworkAdapter>> adapters;
+    std::map<std::string, std::shared_ptr<NetworkAdapter>> adapters;
+    std::unique_ptr<common::FileWatcher> dataFileWatcher;
 };
 
+Manager::Manager(sdbusplus::bus::bus& bus, const sdeventplus::Event& event) :
+    NetworkAdapterManagerServer(bus, dbus::netadpmgr::path), bus(bus)
+{
+    try
+    {
+        dataFileWatcher = std::make_unique<common::FileWatcher>(
+            event, adaptersDataFile, [this]() { rescan(); });
+    }
+    catch (const std::exception& ex)
+    {
+        log<level::ERR>("failed to watch network adapters file",
+                        entry("VALUE=%s", adaptersDataFile),
+                        entry("ERROR=%s", ex.what()));
+    }
+}
+
 /**
  * @brief Find network adapters information and create corresponding dbus objects
  *
@@ -47,8 +68,19 @@ void Manager::rescan()
     json jsonData;
     if (!dataFile.is_open())
     {
-        log<level::ERR>("failed to open file",
-                        entry("VALUE=%s", adaptersDataFile));
+        std::error_code ec;
+        if (std::filesystem::exists(adaptersDataFile, ec) || ec)
+        {
+            log<level::ERR>("failed to open file",
+                            entry("VALUE=%s", adaptersDataFile));
+            return;
+        }
+        // the host has removed the file, so the adapters it has reported
+        // before are not known anymore
+        log<level::INFO>("network adapters file is missing, adapters are "
+                         "dropped",
+                         entry("VALUE=%s", adaptersDataFile));
+        adapters.clear();
         return;
     }
 
@@ -62,12 +94,27 @@ void Manager::rescan()
             return;
         }
 
-        adapters.clear();
+        // only the real changes are published, the existing objects are
+        // updated in place
+        std::set<std::string> names;
         for (const auto& [adapterName, adapter] : jsonData.items())
         {
-            adapters.emplace_back(std::make_shared<NetworkAdapter>(
-                bus, adapterName, adapter["Vendor"], adapter["Device"],
-                adapter["Mac"]));
+            names.insert(adapterName);
+            auto it = adapters.find(adapterName);
+            if (it != adapters.end())
+            {
+                it->second->update(adapter["Vendor"], adapter["Device"],
+                                   adapter["Mac"]);
+                continue;
+            }
+            adapters.emplace(adapterName,
+                             std::make_shared<NetworkAdapter>(
+                                 bus, adapterName, adapter["Vendor"],
+                                 adapter["Device"], adapter["Mac"]));
+        }
+        for (auto it = adapters.begin(); it != adapters.end();)
+        {
+            it = names.count(it->first) ? std::next(it) : adapters.erase(it);
         }
     }
     catch (const std::exception& ex)
@@ -86,17 +133,13 @@ void Manager::rescan()
 int main()
 {
     auto bus = sdbusplus::bus::new_default();
+    auto event = sdeventplus::Event::get_default();
+    bus.attach_event(event.get(), SD_EVENT_PRIORITY_NORMAL);
     sdbusplus::server::manager_t objManager(bus, "/");
 
     bus.request_name(dbus::netadpmgr::busName);
-    Manager networkAdapterManager(bus);
+    Manager networkAdapterManager(bus, event);
 
     networkAdapterManager.rescan();
-    while (1)
-    {
-        bus.process_discard();
-        bus.wait();
-    }
-
-    return 0;
+    return event.loop();
 }
@@ -7,220 +7,31 @@
 
 #include "backplane_mcu_driver.hpp"
 #include "common.hpp"
-#include "common_i2c.hpp"
 #include "dbus.hpp"
+#include "nvme_vpd.hpp"
 #include "xyz/openbmc_project/Common/error.hpp"
 
-#include <unistd.h>
-
 #include <phosphor-logging/log.hpp>
 
 using namespace phosphor::logging;
 using namespace sdbusplus::xyz::openbmc_project::Common::Error;
 
-static constexpr const char* updaterApp = "/usr/bin/yadro-mcu-updater";
-static constexpr int nvmeVPDAddr = 0x53;
-static std::string getNVMeSerialNumberFRU(i2cDev& dev,
-                                          const unsigned char* buf);
-static std::string getNVMeSerialNumberV1A(i2cDev& dev,
-                                          const unsigned char* buf);
-
-static std::string getNVMeSerialNumber(const std::string driveBus)
-{
-    if (driveBus.empty())
-    {
-        return "";
-    }
-    i2cDev dev(driveBus, nvmeVPDAddr);
-    if (!dev.isOk())
-    {
-        return "";
-    }
-    int res;
-    unsigned char buf[i2cDev::i2cBlockSize] = {0};
-
-    res = dev.write_byte(0);
-    if (res < 0)
-    {
-        log<level::ERR>("Failed to communicate with drive I2C",
-                        entry("RESULT=%d", res),
-                        entry("REASON=%s", std::strerror(-res)));
-        return "";
-    }
-    res = dev.read_i2c_block_data(0, sizeof(buf), buf);
-    if (res < 0)
-    {
-        log<level::ERR>("Failed to read drive VPD area",
-                        entry("RESULT=%d", res),
-                        entry("REASON=%s", std::strerror(-res)));
-        return "";
-    }
-    std::string sn = getNVMeSerialNumberFRU(dev, buf);
-    if (sn.empty())
-    {
-        sn = getNVMeSerialNumberV1A(dev, buf);
-    }
-    rtrim(sn);
-    return sn;
-}
-
-static constexpr size_t fruBlockSize =
-    8; // FRU areas are measured in 8-byte blocks
-static constexpr size_t fruHeaderSize = 8;
-static constexpr size_t fruAreaProductByte = 4;
-static constexpr size_t fruProductSNFieldNumber = 5;
-
-enum FRUDataEncoding
-{
-    binary = 0x0,
-    bcdPlus = 0x1,
-    sixBitASCII = 0x2,
-    languageDependent = 0x3,
-};
-
-static bool fruValidateHeader(const unsigned char* blockData)
-{
-    // ipmi spec format version number is currently at 1, verify it
-    if (blockData[0] != 0x1)
-    {
-        return false;
-    }
-
-    // verify pad is set to 0
-    if (blockData[6] != 0x0)
-    {
-        return false;
-    }
-
-    // validate checksum
-    size_t sum = 0;
-    for (int jj = 0; jj < fruHeaderSize; jj++)
-    {
-        sum += blockData[jj];
-    }
-    sum = (256 - sum) & 0xFF;
-
-    if (sum)
-    {
-        return false;
-    }
-    return true;
-}
-
-// Calculate new checksum for fru info area
-static uint8_t fruCalculateChecksum(unsigned char* data, size_t len)
-{
-    constexpr int checksumMod = 256;
-    constexpr uint8_t modVal = 0xFF;
-    int sum = 0;
-    for (size_t index = 0; index < len; index++)
-    {
-        sum += data[index];
-    }
-    int checksum = (checksumMod - sum) & modVal;
-    return static_cast<uint8_t>(checksum);
-}
-
-static std::string getNVMeSerialNumberFRU(i2cDev& dev, const unsigned char* buf)
-{
-    static_assert(i2cDev::i2cBlockSize >= fruBlockSize);
-    int res;
-
-    // Try parse FRU header
-    if (!fruValidateHeader(buf) || !buf[fruAreaProductByte])
-    {
-        return "";
-    }
-
-    const size_t productAreaOffset = buf[fruAreaProductByte] * fruBlockSize;
-    res = dev.read_byte_data(productAreaOffset + 1);
-    if (res < 0)
-    {
-        log<level::ERR>("Failed to read drive FRU product area size",
-                        entry("RESULT=%d", res),
-                        entry("REASON=%s", std::strerror(-res)));
-        return "";
-    }
-    const size_t productAreaSize = res * fruBlockSize;
-
-    int dataAddr = 0;
-    unsigned char data[256] = {0};
-    unsigned char* bufPtr = data;
-    do
-    {
-        const int dataSize = productAreaSize - dataAddr;
-        const int readBytes =
-            (dataSize > i2cDev::i2cBlockSize) ? i2cDev::i2cBlockSize : dataSize;
-        res = dev.read_i2c_block_data(productAreaOffset + dataAddr, readBytes,
-                                      bufPtr);
-        if (res < 0)
-        {
-            log<level::ERR>("Failed to read drive FRU product area data",
-                            entry("RESULT=%d", res),
-                            entry("REASON=%s", std::strerror(-res)));
-            return "";
-        }
-        dataAddr += readBytes;
-        bufPtr += readBytes;
-    } while (dataAddr < productAreaSize);
-
-    if (fruCalculateChecksum(data, productAreaSize) != 0)
-    {
-        log<level::ERR>("Drive FRU product area checksum error",
-                        entry("RESULT=%d", res),
-                        entry("REASON=%s", std::strerror(-res)));
-        return "";
-    }
-
-    // skip fields other then SN
-    size_t offset = 3;
-    for (size_t index = 0; index < fruProductSNFieldNumber - 1; index++)
-    {
-
-        offset += 1 + (data[offset] & 0x3F);
-    }
-    const size_t snLen = data[offset] & 0x3F;
-    const size_t snType = (data[offset] >> 6) & 0x03;
-
-    if (snType != FRUDataEncoding::languageDependent)
-    {
-        log<level::ERR>(
-            "Only 8-bit ASCII supported for drive FRU Serial Number field",
-            entry("RESULT=%d", res), entry("REASON=%s", std::strerror(-res)));
-        return "";
-    }
-
-    const char* snPtr = reinterpret_cast<char*>(data + offset + 1);
-    return std::string{snPtr, snLen};
-}
-
-constexpr size_t v1aSNFieldOffset = 5;
-constexpr size_t v1aSNFieldSize = 20;
-
-static std::string getNVMeSerialNumberV1A(i2cDev& dev, const unsigned char* buf)
-{
-    static_assert(i2cDev::i2cBlockSize >= v1aSNFieldOffset + v1aSNFieldSize);
-
-    if (!((buf[0] == 0x02) && (buf[1] == 0x08) && (buf[2] == 0x01)))
-    {
-        return "";
-    }
-
-    const char* snPtr = reinterpret_cast<const char*>(buf);
-    return std::string{snPtr + v1aSNFieldOffset, v1aSNFieldSize};
-}
+bool BackplaneController::drivesSignal = true;
 
 BackplaneController::BackplaneController(
     sdbusplus::bus::bus& bus, int i2cBus, int i2cAddr, std::string name,
-    const BackplaneControllerConfig& config, std::string inventoryItem) :
+    const BackplaneControllerConfig& config, std::string inventoryItem,
+    UpdateScheduler& updateScheduler, const std::optional<State>& lastState) :
     BackplaneMCUServer(
         bus, dbusEscape(std::string(dbus::stormgr::path) + "/backplane/" + name)
                  .c_str()),
     SoftwareVersionServer(bus, dbusEscape(std::string(dbus::software::path) +
                                           "/backplane_active/" + name)
                                    .c_str()),
-    i2cBusDev("/dev/i2c-" + std::to_string(i2cBus)), i2cAddr(i2cAddr),
-    cfg(config), inventory(inventoryItem)
+    bus(bus), name(name), i2cBus(i2cBus),
+    i2cBusDev("/dev/i2c-" + std::to_string(i2cBus)),
+    i2cAddr(i2cAddr), cfg(config), updateScheduler(updateScheduler),
+    inventory(inventoryItem)
 {
     std::vector<Association> assoc;
     assoc.emplace_back("inventory", "activation", inventory);
@@ -228,7 +39,39 @@ BackplaneController::BackplaneController(
     activation(Activations::Active);
     requestedActivation(RequestedActivations::None);
     purpose(VersionPurpose::Other);
-    refresh();
+    createSlots();
+    if (lastState)
+    {
+        // publish the last known state, MCU is probed later by refresh
+        version(lastState->version);
+        extendedVersion(lastState->boardType);
+        setDrives(lastState->drives);
+        // force to reread drives state on the first refresh
+        cachedState = ~cachedState;
+        return;
+    }
+    if (!isUpdating())
+    {
+        // MCU being reflashed is probed when the reflash is completed
+        refresh();
+    }
+}
+
+/**
+ * @brief Get current state to be restored on the next start
+ */
+BackplaneController::State BackplaneController::getState()
+{
+    State state;
+    state.version = version();
+    state.boardType = extendedVersion();
+    state.drives = drives();
+    return state;
+}
+
+BackplaneController::~BackplaneController()
+{
+    updateScheduler.remove(i2cBusDev, i2cAddr);
 }
 
 void BackplaneController::updateConfig(const BackplaneControllerConfig& config)
@@ -238,16 +81,59 @@ void BackplaneController::updateConfig(const BackplaneControllerConfig& config)
         return;
     }
     cfg = config;
+    createSlots();
+    slotsVPD.clear();
+    invalidateRefresh();
     refresh();
 }
 
-bool BackplaneController::refresh()
+/**
+ * @brief Refresh backplane state
+ *
+ * The daemon serves requests one by one, so a burst of requests (e.g. Redfish
+ * polling several drives) results in a series of refreshes within
+ * milliseconds. The result of the recent refresh is shared by such requests
+ * instead of scanning MCU again.
+ *
+ * @param[in] maxAge - max age of the previous refresh result to be reused
+ * @return true if the state is actual
+ */
+bool BackplaneController::refresh(std::chrono::milliseconds maxAge)
 {
+    const auto now = std::chrono::steady_clock::now();
+    if (!isUpdating() && (now - lastRefreshTime) < maxAge)
+    {
+        return lastRefreshResult;
+    }
     const bool res = doRefresh();
     functional(res);
+    if (res)
+    {
+        verified(true);
+    }
+    lastRefreshTime = std::chrono::steady_clock::now();
+    lastRefreshResult = res;
     return res;
 }
 
+/**
+ * @brief Drop MCU state cached by the controller, the MCU is probed again on
+ *        the next refresh
+ */
+void BackplaneController::invalidate()
+{
+    // protocol may be changed by the new firmware
+    mcuDriver.reset();
+    cachedState = ~cachedState;
+    verified(false);
+    invalidateRefresh();
+}
+
+void BackplaneController::invalidateRefresh()
+{
+    lastRefreshTime = std::chrono::steady_clock::time_point();
+}
+
 bool BackplaneController::doRefresh()
 {
     if (isUpdating())
@@ -256,13 +142,11 @@ bool BackplaneController::doRefresh()
     }
     try
     {
-        auto mcu = backplaneMCU(i2cBusDev, i2cAddr);
-        if (!mcu)
-        {
-            return false;
-        }
+        // the driver is recreated to drop the state cached by previous one
+        mcuDriver = backplaneMCU(i2cBusDev, i2cAddr);
+        const auto& mcu = mcuDriver;
 
-        if (version().empty())
+        if (version().empty() || !verified())
         {
             const auto fwVersion = mcu->getFwVersion();
             if (!fwVersion.empty())
@@ -270,7 +154,7 @@ bool BackplaneController::doRefresh()
                 version(fwVersion);
             }
         }
-        if (extendedVersion().empty())
+        if (extendedVersion().empty() || !verified())
         {
             const auto backplaneControllerType = mcu->getBoardType();
             if (!backplaneControllerType.empty())
@@ -279,13 +163,25 @@ bool BackplaneController::doRefresh()
             }
         }
 
-        std::vector<std::tuple<std::string, std::string, DriveInterface, bool>>
-            drivesState;
-        if (!(mcu->isStateChanged(cachedState) || drives().empty()))
+        DrivesList drivesState;
+        uint8_t replaced = 0;
+        if (!(mcu->isStateChanged(cachedState, replaced) || drives().empty()))
         {
             return true;
         }
 
+        // the latch is cleared by the read, so the replaced drives are
+        // recorded before anything else can fail
+        for (const auto& [chanIndex, chanName] : cfg.channels)
+        {
+            if (chanIndex >= 0 &&
+                chanIndex < BackplaneMCUDriver::maxChannelsNumber &&
+                (replaced & (1 << chanIndex)))
+            {
+                ++slotsVPD[chanName].generation;
+            }
+        }
+
         for (const auto& [chanIndex, chanName] : cfg.channels)
         {
             std::string sn;
@@ -300,6 +196,12 @@ bool BackplaneController::doRefresh()
             }
             bool present = mcu->drivePresent(chanIndex);
             bool failure = mcu->driveFailured(chanIndex);
+            auto& slot = slotsVPD[chanName];
+            if (slot.present != present)
+            {
+                slot.present = present;
+                ++slot.generation;
+            }
             DriveTypes driveType = mcu->driveType(chanIndex);
             DriveInterface driveIface = DriveInterface::Unknown;
             switch (driveType)
@@ -347,44 +249,252 @@ bool BackplaneController::doRefresh()
 
             drivesState.emplace_back(chanName, sn, driveIface, failure);
         }
-        drives(drivesState);
+        setDrives(drivesState);
     }
     catch (...)
     {
+        mcuDriver.reset();
         return false;
     }
     return true;
 }
 
+/**
+ * @brief Get MCU driver, the driver is cached until the next refresh or a
+ *        communication failure
+ */
+const std::unique_ptr<BackplaneMCUDriver>& BackplaneController::driver()
+{
+    if (!mcuDriver)
+    {
+        mcuDriver = backplaneMCU(i2cBusDev, i2cAddr);
+    }
+    return mcuDriver;
+}
+
+/**
+ * @brief Get drive VPD data, VPD is read only if the drive has been replaced
+ *        since the previous read
+ *
+ * @param[in] chanName - channel name
+ * @param[in] bypassCache - read VPD from the drive even if it is cached
+ * @return VPD data, the fields are empty on failure
+ */
+const DriveVPD& BackplaneController::readDriveVPD(const std::string& chanName,
+                                                  bool bypassCache)
+{
+    auto& slot = slotsVPD[chanName];
+    if (bypassCache)
+    {
+        ++vpdStats.forcedReads;
+    }
+    else if (slot.cached && slot.cachedGeneration == slot.generation)
+    {
+        ++vpdStats.hits;
+        vpdStats.bytesSaved += slot.vpd.bytesRead;
+        return slot.vpd;
+    }
+    else
+    {
+        ++vpdStats.misses;
+    }
+    slot.vpd = readNVMeVPD(getBusByChanName(chanName));
+    slot.cachedGeneration = slot.generation;
+    // failed reads are retried on the next request
+    slot.cached = !slot.vpd.serialNumber.empty();
+    return slot.vpd;
+}
+
 std::string BackplaneController::readDriveSN(const std::string& chanName)
 {
-    return getNVMeSerialNumber(getBusByChanName(chanName));
+    return readDriveVPD(chanName).serialNumber;
 }
 
-std::string
-    BackplaneController::findChannelByDriveSN(const std::string& driveSN)
+/**
+ * @brief Get cached drive VPD data, no I2C transactions are performed
+ *
+ * @param[in] chanName - channel name
+ * @return VPD data or nullptr if nothing is cached for the slot
+ */
+const DriveVPD*
+    BackplaneController::cachedDriveVPD(const std::string& chanName) const
+{
+    const auto it = slotsVPD.find(chanName);
+    if (it == slotsVPD.end() || !it->second.cached ||
+        it->second.cachedGeneration != it->second.generation)
+    {
+        return nullptr;
+    }
+    return &it->second.vpd;
+}
+
+/**
+ * @brief Drop cached drives VPD, it will be read again on the next refresh
+ */
+void BackplaneController::rescanDrives()
+{
+    if (vpdStats.hits + vpdStats.misses)
+    {
+        log<level::INFO>(
+            "Drive VPD cache statistics", entry("BUS=%s", i2cBusDev.c_str()),
+            entry("ADDR=%d", i2cAddr), entry("HITS=%zu", vpdStats.hits),
+            entry("MISSES=%zu", vpdStats.misses),
+            entry("HIT_PERCENT=%zu", vpdStats.hits * 100 /
+                                         (vpdStats.hits + vpdStats.misses)),
+            entry("BYTES_SAVED=%zu", vpdStats.bytesSaved),
+            entry("FORCED_READS=%zu", vpdStats.forcedReads));
+    }
+    for (auto& [_, slot] : slotsVPD)
+    {
+        slot.cached = false;
+    }
+    // force to reread drives state on next query
+    cachedState = ~cachedState;
+    invalidateRefresh();
+}
+
+void BackplaneController::setDrives(const DrivesList& drivesState)
+{
+    drives(drivesState, !drivesSignal);
+
+    // only the changed properties are signaled
+    for (const auto& [chanName, slot] : slots)
+    {
+        const auto it = std::find_if(
+            drivesState.begin(), drivesState.end(),
+            [&chanName = chanName](const auto& drive) {
+                return std::get<0>(drive) == chanName;
+            });
+        std::string sn;
+        DriveInterface driveIface = DriveInterface::Unknown;
+        bool failure = false;
+        if (it != drivesState.end())
+        {
+            std::tie(std::ignore, sn, driveIface, failure) = *it;
+        }
+        slot->present(driveIface == DriveInterface::SATA_SAS ||
+                      driveIface == DriveInterface::NVMe);
+        slot->serialNumber(sn);
+        slot->driveInterface(driveIface);
+        slot->failed(failure);
+    }
+
+    if (drivesObserver)
+    {
+        drivesObserver(name, drivesState);
+    }
+}
+
+/**
+ * @brief Create objects for the configured slots and drop the rest
+ */
+void BackplaneController::createSlots()
+{
+    for (auto it = slots.begin(); it != slots.end();)
+    {
+        it = hasChannel(it->first) ? std::next(it) : slots.erase(it);
+    }
+    for (const auto& [_, chanName] : cfg.channels)
+    {
+        if (slots.find(chanName) == slots.end())
+        {
+            slots.emplace(chanName,
+                          std::make_unique<BackplaneSlotServer>(
+                              bus, dbusEscape(std::string(dbus::stormgr::path) +
+                                              "/backplane/" + name + "/" +
+                                              chanName)
+                                       .c_str()));
+        }
+    }
+}
+
+void BackplaneController::setSlotLocationLED(const std::string& chanName,
+                                             bool state)
+{
+    const auto it = slots.find(chanName);
+    if (it != slots.end())
+    {
+        it->second->locationLED(state);
+    }
+}
+
+void BackplaneController::setDrivesObserver(DrivesObserver observer)
+{
+    drivesObserver = std::move(observer);
+    if (drivesObserver)
+    {
+        drivesObserver(name, drives());
+    }
+}
+
+bool BackplaneController::verifyDriveSN(const std::string& chanName,
+                                        const std::string& driveSN)
+{
+    return verifyDrivesSN({{chanName, driveSN}}).front();
+}
+
+std::vector<bool> BackplaneController::verifyDrivesSN(
+    const std::vector<std::pair<std::string, std::string>>& drives)
+{
+    if (isUpdating())
+    {
+        throw NotAllowed();
+    }
+    // the cached VPD is trusted only if the MCU reports the drives swapped
+    // between two polls, otherwise the serial number is read from the drive
+    const bool trusted =
+        refresh() && mcuDriver && mcuDriver->reportsReplacement();
+
+    std::vector<bool> result;
+    bool mismatch = false;
+    for (const auto& [chanName, driveSN] : drives)
+    {
+        const bool match =
+            driveSN == readDriveVPD(chanName, !trusted).serialNumber;
+        if (!match)
+        {
+            slotsVPD[chanName].cached = false;
+            mismatch = true;
+        }
+        result.push_back(match);
+    }
+    if (mismatch)
+    {
+        // force to refresh on next query
+        cachedState = ~cachedState;
+        invalidateRefresh();
+    }
+    return result;
+}
+
+bool BackplaneController::hasChannel(const std::string& chanName) const
+{
+    return std::any_of(
+        cfg.channels.begin(), cfg.channels.end(),
+        [&chanName](const auto& it) { return it.second == chanName; });
+}
+
+/**
+ * @brief Get the slot state
+ *
+ * @param[in] chanName - channel name
+ * @return tuple of drive interface, serial number and failure flag
+ */
+std::tuple<DriveInterface, std::string, bool>
+    BackplaneController::getSlotStatus(const std::string& chanName)
 {
     if (!refresh())
     {
         throw InternalFailure();
     }
-    std::vector<std::tuple<std::string, std::string, DriveInterface, bool>>
-        drivesState = drives();
-    for (const auto& [chanName, sn, driveIface, failure] : drivesState)
+    for (const auto& [chan, sn, driveIface, failure] : drives())
     {
-        if (sn == driveSN)
+        if (chan == chanName)
         {
-            // verify information still actual
-            if (sn != readDriveSN(chanName))
-            {
-                // force to refresh on next query
-                cachedState = ~cachedState;
-                break;
-            }
-            return chanName;
+            return std::make_tuple(driveIface, sn, failure);
         }
     }
-    return "";
+    return std::make_tuple(DriveInterface::Unknown, std::string(), false);
 }
 
 int BackplaneController::channelIndexByName(const std::string& chanName)
@@ -426,14 +536,16 @@ void BackplaneController::setDriveLocationLED(const std::string& chanName,
 
     try
     {
-        auto mcu = backplaneMCU(i2cBusDev, i2cAddr);
+        const auto& mcu = driver();
         mcu->setDriveLocationLED(chanIndex, assert);
     }
     catch (...)
     {
+        mcuDriver.reset();
         functional(false);
         throw InternalFailure();
     }
+    setSlotLocationLED(chanName, assert);
 }
 
 bool BackplaneController::getDriveLocationLED(const std::string& chanName)
@@ -453,14 +565,125 @@ bool BackplaneController::getDriveLocationLED(const std::string& chanName)
     }
     try
     {
-        auto mcu = backplaneMCU(i2cBusDev, i2cAddr);
+        const auto& mcu = driver();
         result = mcu->getDriveLocationLED(chanIndex);
     }
     catch (...)
     {
+        mcuDriver.reset();
         functional(false);
         throw InternalFailure();
     }
+    setSlotLocationLED(chanName, result);
+    return result;
+}
+
+/**
+ * @brief Set location LEDs of several channels with a single MCU command
+ *
+ * @param[in] requests - list of channel names and requested LED states, the
+ *                       last request wins if a channel is listed twice
+ */
+void BackplaneController::setDriveLocationLEDs(
+    const std::vector<std::pair<std::string, bool>>& requests)
+{
+    if (isUpdating())
+    {
+        throw NotAllowed();
+    }
+    uint8_t assertMask = 0;
+    uint8_t deassertMask = 0;
+    for (const auto& [chanName, assert] : requests)
+    {
+        int chanIndex = channelIndexByName(chanName);
+        if (chanIndex < 0 ||
+            chanIndex >= BackplaneMCUDriver::maxChannelsNumber)
+        {
+            log<level::ERR>("Wrong channels configuration",
+                            entry("BUS=%s", i2cBusDev.c_str()),
+                            entry("ADDR=%d", i2cAddr),
+                            entry("CHANNEL_INDEX=%d", chanIndex));
+            throw InternalFailure();
+        }
+        const uint8_t mask = 1 << chanIndex;
+        if (assert)
+        {
+            assertMask |= mask;
+            deassertMask &= ~mask;
+        }
+        else
+        {
+            deassertMask |= mask;
+            assertMask &= ~mask;
+        }
+    }
+
+    try
+    {
+        const auto& mcu = driver();
+        mcu->setDriveLocationLEDs(assertMask, deassertMask);
+    }
+    catch (...)
+    {
+        mcuDriver.reset();
+        functional(false);
+        throw InternalFailure();
+    }
+    for (const auto& [chanName, assert] : requests)
+    {
+        setSlotLocationLED(chanName, assert);
+    }
+}
+
+/**
+ * @brief Get location LEDs state of several channels with a single MCU
+ *        command
+ *
+ * @param[in] chanNames - list of channel names
+ * @return LED states in the order of \p chanNames
+ */
+std::vector<bool> BackplaneController::getDriveLocationLEDs(
+    const std::vector<std::string>& chanNames)
+{
+    if (isUpdating())
+    {
+        throw NotAllowed();
+    }
+    std::vector<int> chanIndexes;
+    for (const auto& chanName : chanNames)
+    {
+        int chanIndex = channelIndexByName(chanName);
+        if (chanIndex < 0 ||
+            chanIndex >= BackplaneMCUDriver::maxChannelsNumber)
+        {
+            log<level::ERR>("Wrong channels configuration",
+                            entry("BUS=%s", i2cBusDev.c_str()),
+                            entry("ADDR=%d", i2cAddr),
+                            entry("CHANNEL_INDEX=%d", chanIndex));
+            throw InternalFailure();
+        }
+        chanIndexes.push_back(chanIndex);
+    }
+
+    uint8_t locationLEDs = 0;
+    try
+    {
+        const auto& mcu = driver();
+        locationLEDs = mcu->getDriveLocationLEDs();
+    }
+    catch (...)
+    {
+        mcuDriver.reset();
+        functional(false);
+        throw InternalFailure();
+    }
+
+    std::vector<bool> result;
+    for (size_t i = 0; i < chanIndexes.size(); ++i)
+    {
+        result.push_back(locationLEDs & (1 << chanIndexes[i]));
+        setSlotLocationLED(chanNames[i], result.back());
+    }
     return result;
 }
 
@@ -472,14 +695,19 @@ void BackplaneController::resetDriveLocationLEDs()
     }
     try
     {
-        auto mcu = backplaneMCU(i2cBusDev, i2cAddr);
+        const auto& mcu = driver();
         mcu->resetDriveLocationLEDs();
     }
     catch (...)
     {
+        mcuDriver.reset();
         functional(false);
         throw InternalFailure();
     }
+    for (const auto& [chanName, _] : slots)
+    {
+        setSlotLocationLED(chanName, false);
+    }
 }
 
 void BackplaneController::hostPowerChanged(bool powered)
@@ -490,11 +718,12 @@ void BackplaneController::hostPowerChanged(bool powered)
     }
     try
     {
-        auto mcu = backplaneMCU(i2cBusDev, i2cAddr);
+        const auto& mcu = driver();
         mcu->setHostPowerState(powered);
     }
     catch (...)
     {
+        mcuDriver.reset();
         functional(false);
     }
 }
@@ -504,65 +733,45 @@ bool BackplaneController::updateImage(std::filesystem::path imagePath,
                                       std::string dbusObject,
                                       std::shared_ptr<SoftwareObject> updater)
 {
-    pid_t pid = fork();
-    if (pid == 0)
-    {
-        // clang-format off
-        execlp(updaterApp, updaterApp,
-               "-f", imagePath.string().c_str(),
-               "-b", i2cBusDev.c_str(),
-               "-a", std::to_string(i2cAddr).c_str(),
-               "-v", imageVersion.c_str(),
-               nullptr);
-        // clang-format on
-        log<level::ERR>(
-            "ERROR: execl failed", entry("BUS=%s", i2cBusDev.c_str()),
-            entry("ADDR=%d", i2cAddr), entry("REASON=%d", strerror(errno)));
-        exit(EXIT_FAILURE);
-    }
-    else if (pid < 0)
-    {
-        log<level::ERR>(
-            "ERROR: fork failed", entry("BUS=%s", i2cBusDev.c_str()),
-            entry("ADDR=%d", i2cAddr), entry("REASON=%d", strerror(errno)));
-        return false;
-    }
-    auto event = sdeventplus::Event::get_default();
-
-    int options = WEXITED | WSTOPPED | WCONTINUED;
-    updaterWatcher = sdeventplus::source::Child(
-        event, pid, options,
-        [this, updater](sdeventplus::source::Child& source,
-                        const siginfo_t* si) {
-            if ((si->si_code == CLD_EXITED) && (si->si_status == EXIT_SUCCESS))
-            {
-                updater->activation(
-                    sdbusplus::xyz::openbmc_project::Software::server::
-                        Activation::Activations::Active);
-            }
-            else
-            {
-                log<level::ERR>("Updater process failed",
-                                entry("BUS=%s", i2cBusDev.c_str()),
-                                entry("ADDR=%d", i2cAddr),
-                                entry("SIGNO=%d", si->si_signo),
-                                entry("CODE=%d", si->si_code),
-                                entry("STATUS=%d", si->si_status));
-                updater->activation(
-                    sdbusplus::xyz::openbmc_project::Software::server::
-                        Activation::Activations::Failed);
-            }
-            version(std::string());
-            extendedVersion(std::string());
-            drives(std::vector<std::tuple<std::string, std::string,
-                                          DriveInterface, bool>>());
-            updaterWatcher.reset();
-        });
+    UpdateScheduler::Request request;
+    request.devPath = i2cBusDev;
+    request.addr = i2cAddr;
+    request.imagePath = imagePath;
+    request.imageVersion = imageVersion;
+    request.onProgress = [updater](uint8_t progress) {
+        updater->updateProgress(progress);
+    };
+    request.onComplete = [this, updater](bool success) {
+        updater->activation(
+            success ? sdbusplus::xyz::openbmc_project::Software::server::
+                          Activation::Activations::Active
+                    : sdbusplus::xyz::openbmc_project::Software::server::
+                          Activation::Activations::Failed);
+        // protocol may be changed by the new firmware
+        mcuDriver.reset();
+        slotsVPD.clear();
+        invalidateRefresh();
+        version(std::string());
+        extendedVersion(std::string());
+        setDrives(DrivesList());
+    };
+    request.onQueue = [updater](uint32_t position,
+                                std::chrono::seconds timeLeft) {
+        updater->updateQueueState(position, timeLeft.count());
+    };
+
+    return updateScheduler.submit(std::move(request));
+}
 
-    return true;
+void BackplaneController::cancelUpdate()
+{
+    log<level::INFO>("Cancelling firmware update",
+                     entry("BUS=%s", i2cBusDev.c_str()),
+                     entry("ADDR=%d", i2cAddr));
+    updateScheduler.cancel(i2cBusDev, i2cAddr);
 }
 
 bool BackplaneController::isUpdating()
 {
-    return updaterWatcher.has_value();
+    return updateScheduler.isActive(i2cBusDev, i2cAddr);
 }
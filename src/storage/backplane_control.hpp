@@ -5,20 +5,29 @@
 
 #pragma once
 
+#include "backplane_mcu_driver.hpp"
 #include "com/yadro/HWManager/BackplaneMCU/server.hpp"
+#include "com/yadro/HWManager/BackplaneSlot/server.hpp"
 #include "common_swupd.hpp"
+#include "nvme_vpd.hpp"
+#include "update_scheduler.hpp"
 
-#include <sdeventplus/source/child.hpp>
 #include <xyz/openbmc_project/Association/Definitions/server.hpp>
 #include <xyz/openbmc_project/Software/Activation/server.hpp>
 #include <xyz/openbmc_project/Software/ExtendedVersion/server.hpp>
 #include <xyz/openbmc_project/Software/Version/server.hpp>
 #include <xyz/openbmc_project/State/Decorator/OperationalStatus/server.hpp>
 
+#include <chrono>
+#include <functional>
+#include <optional>
+
 using BackplaneMCUServer = sdbusplus::server::object_t<
     sdbusplus::com::yadro::HWManager::server::BackplaneMCU,
     sdbusplus::xyz::openbmc_project::State::Decorator::server::
         OperationalStatus>;
+using BackplaneSlotServer = sdbusplus::server::object_t<
+    sdbusplus::com::yadro::HWManager::server::BackplaneSlot>;
 using SoftwareVersionServer = sdbusplus::server::object_t<
     sdbusplus::xyz::openbmc_project::Association::server::Definitions,
     sdbusplus::xyz::openbmc_project::Software::server::Activation,
@@ -50,22 +59,86 @@ class BackplaneController :
     public FirmwareUpdateble
 {
   public:
+    /** @brief Drive slots state: [Port, SN, DriveInterface, Failed] */
+    using DrivesList =
+        std::vector<std::tuple<std::string, std::string, DriveInterface, bool>>;
+    /** @brief Handler to be called when drive slots state is changed */
+    using DrivesObserver =
+        std::function<void(const std::string&, const DrivesList&)>;
+
+    /**
+     * @brief Last known state, published until the MCU is probed
+     */
+    struct State
+    {
+        std::string version;   //!< MCU firmware version
+        std::string boardType; //!< backplane type reported by MCU
+        DrivesList drives;     //!< drive slots state
+    };
+
     BackplaneController(sdbusplus::bus::bus& bus, int i2cBus, int i2cAddr,
                         std::string name,
                         const BackplaneControllerConfig& config,
-                        std::string inventoryItem);
+                        std::string inventoryItem,
+                        UpdateScheduler& updateScheduler,
+                        const std::optional<State>& lastState = std::nullopt);
+    ~BackplaneController();
+
+    /* Whether the aggregate Drives property change is signaled, the per-slot
+     * objects are signaled anyway */
+    static bool drivesSignal;
 
     void updateConfig(const BackplaneControllerConfig& config);
-    bool refresh();
-    std::string findChannelByDriveSN(const std::string& driveSN);
+
+    /* Refresh results younger than this are reused by default */
+    static constexpr std::chrono::milliseconds refreshCoalesceTime{500};
+
+    bool refresh(std::chrono::milliseconds maxAge = refreshCoalesceTime);
+    void invalidate();
+    bool verifyDriveSN(const std::string& chanName, const std::string& driveSN);
+    /**
+     * @brief Verify several drives at once, the MCU is polled once
+     *
+     * @param[in] drives - channel name and expected SN of each drive
+     * @return verification result of each drive in the same order
+     */
+    std::vector<bool> verifyDrivesSN(
+        const std::vector<std::pair<std::string, std::string>>& drives);
+    bool hasChannel(const std::string& chanName) const;
+    std::tuple<DriveInterface, std::string, bool>
+        getSlotStatus(const std::string& chanName);
+    void setDrivesObserver(DrivesObserver observer);
+    void rescanDrives();
+    const DriveVPD* cachedDriveVPD(const std::string& chanName) const;
     void setDriveLocationLED(const std::string& chanName, bool assert);
     bool getDriveLocationLED(const std::string& chanName);
+    void setDriveLocationLEDs(
+        const std::vector<std::pair<std::string, bool>>& requests);
+    std::vector<bool>
+        getDriveLocationLEDs(const std::vector<std::string>& chanNames);
     void resetDriveLocationLEDs();
     void hostPowerChanged(bool powered);
     std::string getInventory()
     {
         return inventory;
     }
+    int getI2CBus() const
+    {
+        return i2cBus;
+    }
+    int getI2CAddr() const
+    {
+        return i2cAddr;
+    }
+    const BackplaneControllerConfig& getConfig() const
+    {
+        return cfg;
+    }
+    State getState();
+    bool isVerified()
+    {
+        return verified();
+    }
     std::string getType()
     {
         return extendedVersion();
@@ -73,18 +146,60 @@ class BackplaneController :
     bool updateImage(std::filesystem::path imagePath, std::string imageVersion,
                      std::string dbusObject,
                      std::shared_ptr<SoftwareObject> updater);
+    void cancelUpdate();
     bool isUpdating();
 
   private:
+    sdbusplus::bus::bus& bus;
+    std::string name;
+    int i2cBus;
     std::string i2cBusDev;
     int i2cAddr;
     BackplaneControllerConfig cfg;
-    std::optional<sdeventplus::source::Child> updaterWatcher;
+    UpdateScheduler& updateScheduler;
     std::string inventory;
     uint32_t cachedState = 0; //!< cached value of MCU channels state (presence,
                               //!< failures)
+    DrivesObserver drivesObserver;
+
+    /**
+     * @brief Cached drive VPD data of a slot
+     */
+    struct SlotVPD
+    {
+        bool present = false;          //!< last presence reported by MCU
+        unsigned generation = 0;       //!< incremented on drive change
+        bool cached = false;           //!< whether vpd is valid
+        unsigned cachedGeneration = 0; //!< generation the vpd was read at
+        DriveVPD vpd;                  //!< drive VPD data
+    };
+    std::map<std::string, SlotVPD> slotsVPD;
+
+    /**
+     * @brief VPD cache statistics
+     */
+    struct VPDStats
+    {
+        size_t hits = 0;
+        size_t misses = 0;
+        size_t bytesSaved = 0;
+        size_t forcedReads = 0;
+    } vpdStats;
+
+    std::chrono::steady_clock::time_point lastRefreshTime;
+    bool lastRefreshResult = false;
+    std::unique_ptr<BackplaneMCUDriver> mcuDriver;
+    /* Per-slot objects: channel name -> object */
+    std::map<std::string, std::unique_ptr<BackplaneSlotServer>> slots;
 
     bool doRefresh();
+    void invalidateRefresh();
+    const std::unique_ptr<BackplaneMCUDriver>& driver();
+    void setDrives(const DrivesList& drivesState);
+    void createSlots();
+    void setSlotLocationLED(const std::string& chanName, bool state);
+    const DriveVPD& readDriveVPD(const std::string& chanName,
+                                 bool bypassCache = false);
     std::string readDriveSN(const std::string& chanName);
     int channelIndexByName(const std::string& chanName);
 };
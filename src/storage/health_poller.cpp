@@ -0,0 +1,82 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (C) 2022, KNS Group LLC (YADRO)
+ */
+
+#include "health_poller.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <map>
+
+/**
+ * @brief Get identifier of the I2C mux the bus belongs to
+ *
+ * @param[in] devPath - I2C bus device file path
+ * @return sysfs path of the parent device, the bus itself if it is not
+ *         behind a mux
+ */
+static std::string muxGroup(const std::string& devPath)
+{
+    namespace fs = std::filesystem;
+    std::error_code ec;
+    const fs::path busDir = fs::canonical(
+        fs::path("/sys/bus/i2c/devices") / fs::path(devPath).filename(), ec);
+    if (ec)
+    {
+        return devPath;
+    }
+    return busDir.parent_path().string();
+}
+
+HealthPoller::HealthPoller(const sdeventplus::Event& event,
+                           std::chrono::seconds period, unsigned rate,
+                           TargetsProvider provider, ResultHandler handler) :
+    period(period),
+    interval(std::chrono::milliseconds(1000) / std::max(rate, 1U)),
+    provider(std::move(provider)), handler(std::move(handler)),
+    timer(event, [this](auto&) { tick(); })
+{
+    timer.restartOnce(interval);
+}
+
+void HealthPoller::startRound()
+{
+    targets = provider();
+    next = 0;
+    roundStart = std::chrono::steady_clock::now();
+
+    std::map<std::string, std::string> groups;
+    for (const auto& target : targets)
+    {
+        groups.emplace(target.devPath, muxGroup(target.devPath));
+    }
+    std::stable_sort(targets.begin(), targets.end(),
+                     [&groups](const Target& a, const Target& b) {
+                         return groups[a.devPath] < groups[b.devPath];
+                     });
+}
+
+void HealthPoller::tick()
+{
+    if (next >= targets.size())
+    {
+        startRound();
+    }
+    if (next < targets.size())
+    {
+        const Target& target = targets[next++];
+        handler(target.id, readNVMeHealth(target.devPath));
+    }
+
+    if (next < targets.size())
+    {
+        timer.restartOnce(interval);
+        return;
+    }
+    // wait for the rest of the period before the next round
+    const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - roundStart);
+    timer.restartOnce(std::max<std::chrono::milliseconds>(interval,
+                                                          period - elapsed));
+}
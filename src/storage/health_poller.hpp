@@ -0,0 +1,76 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (C) 2022, KNS Group LLC (YADRO)
+ */
+
+#pragma once
+
+#include "nvme_mi.hpp"
+
+#include <sdeventplus/clock.hpp>
+#include <sdeventplus/event.hpp>
+#include <sdeventplus/utility/timer.hpp>
+
+#include <chrono>
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+/**
+ * @class HealthPoller
+ *
+ * This class polls NVMe drives health over the slot SMBus. Only one drive is
+ * polled at a time and the rate of the requests is limited, so the bus load
+ * is bounded regardless of the number of drives. The drives behind the same
+ * I2C mux are polled one after another to avoid needless mux switching.
+ */
+class HealthPoller
+{
+  public:
+    /**
+     * @brief Drive to be polled
+     */
+    struct Target
+    {
+        std::string id;      //!< drive identifier passed to the handler
+        std::string devPath; //!< drive I2C bus device file path
+    };
+
+    /** @brief Provider of the drives list, called on every polling round */
+    using TargetsProvider = std::function<std::vector<Target>()>;
+    /** @brief Handler of the poll result, receives drive identifier and its
+     *         health or empty if the drive doesn't respond */
+    using ResultHandler = std::function<void(
+        const std::string&, const std::optional<NVMeHealth>&)>;
+
+    HealthPoller(const HealthPoller&) = delete;
+    HealthPoller& operator=(const HealthPoller&) = delete;
+
+    /**
+     * @brief Constructor, starts polling
+     *
+     * @param[in] event - event loop
+     * @param[in] period - polling period of every drive
+     * @param[in] rate - max number of drives polled per second
+     * @param[in] provider - drives list provider
+     * @param[in] handler - poll result handler
+     */
+    HealthPoller(const sdeventplus::Event& event, std::chrono::seconds period,
+                 unsigned rate, TargetsProvider provider,
+                 ResultHandler handler);
+
+  private:
+    void tick();
+    void startRound();
+
+    std::chrono::seconds period;
+    std::chrono::milliseconds interval;
+    TargetsProvider provider;
+    ResultHandler handler;
+    sdeventplus::utility::Timer<sdeventplus::ClockId::Monotonic> timer;
+
+    std::vector<Target> targets;
+    size_t next = 0;
+    std::chrono::steady_clock::time_point roundStart;
+};
@@ -12,17 +12,14 @@
 
 #include <charconv>
 #include <fstream>
+#include <limits>
 
 using namespace phosphor::logging;
 
 static constexpr const char* inventorySubPath = "/system/drive/";
 
 StorageDrive::StorageDrive(sdbusplus::bus::bus& bus, const std::string& aName,
-                           const std::string& aPath, const std::string& aProto,
-                           const std::string& aType, const std::string& aVendor,
-                           const std::string& aModel,
-                           const std::string& aSerial,
-                           const std::string& aSizeBytes) :
+                           const StorageDriveInfo& aInfo) :
     sdbusplus::server::object::object<
         sdbusplus::xyz::openbmc_project::Inventory::server::Item>(
         bus, dbusEscape(std::string(dbus::inventory::pathBase) +
@@ -42,12 +39,38 @@ StorageDrive::StorageDrive(sdbusplus::bus::bus& bus, const std::string& aName,
                                           Decorator::server::OperationalStatus>(
         bus, dbusEscape(std::string(dbus::inventory::pathBase) +
                         inventorySubPath + aName)
-                 .c_str())
+                 .c_str()),
+    bus(bus), name(aName),
+    objPath(dbusEscape(std::string(dbus::inventory::pathBase) +
+                       inventorySubPath + aName))
+{
+    update(aInfo);
+    // xyz.openbmc_project.State.Decorator.OperationalStatus
+    functional(true);
+}
+
+/**
+ * @brief Update drive properties, only the changed ones are signaled
+ *
+ * @param[in] aInfo - drive information reported by the host
+ */
+void StorageDrive::update(const StorageDriveInfo& aInfo)
 {
+    // the pretty name is empty until the first update
+    if (aInfo == info && !prettyName().empty())
+    {
+        return;
+    }
+    info = aInfo;
+    const std::string& aSizeBytes = info.sizeBytes;
+    const std::string& aVendor = info.vendor;
+    const std::string& aProto = info.proto;
+    const std::string& aType = info.type;
+
     uint64_t sizeInt = 0;
     std::string sizeStr;
     std::string manuf;
-    std::string name;
+    std::string prettyNameStr;
     // try to render drive size (assume 1KB = 1000B, which is common for storage
     // devices)
     if (!aSizeBytes.empty())
@@ -109,13 +132,13 @@ StorageDrive::StorageDrive(sdbusplus::bus::bus& bus, const std::string& aName,
     // assemble drive name
     if (!aProto.empty())
     {
-        name += aProto + " ";
+        prettyNameStr += aProto + " ";
     }
     if (!sizeStr.empty())
     {
-        name += sizeStr + " ";
+        prettyNameStr += sizeStr + " ";
     }
-    name += aName;
+    prettyNameStr += name;
 
     DriveProtocol proto = DriveProtocol::Unknown;
     if (aProto == "SATA")
@@ -141,16 +164,63 @@ StorageDrive::StorageDrive(sdbusplus::bus::bus& bus, const std::string& aName,
     }
 
     // xyz.openbmc_project.Inventory.Item
-    prettyName(name);
+    prettyName(prettyNameStr);
     present(true);
     // xyz.openbmc_project.Inventory.Item.Drive
     capacity(sizeInt);
     type(driveType);
     protocol(proto);
     // xyz.openbmc_project.Inventory.Decorator.Asset
-    serialNumber(aSerial);
-    manufacturer(manuf);
-    model(aModel);
-    // xyz.openbmc_project.State.Decorator.OperationalStatus
-    functional(true);
+    serialNumber(info.serial);
+    vendorName = manuf;
+    updateAsset();
+}
+
+/**
+ * @brief Fill the asset fields not provided by the host with the data read
+ *        from the drive VPD
+ *
+ * @param[in] vpd - drive VPD data
+ */
+void StorageDrive::mergeAsset(const DriveVPD& aVPD)
+{
+    vpd = aVPD;
+    updateAsset();
+}
+
+void StorageDrive::updateAsset()
+{
+    manufacturer(!vendorName.empty() ? vendorName : vpd.manufacturer);
+    model(!info.model.empty() ? info.model : vpd.model);
+    partNumber(vpd.partNumber);
+}
+
+/**
+ * @brief Publish drive health, the interface is added on the first update
+ *
+ * @param[in] data - drive health or empty if the drive doesn't respond
+ */
+void StorageDrive::updateHealth(const std::optional<NVMeHealth>& data)
+{
+    if (!health)
+    {
+        if (!data)
+        {
+            return;
+        }
+        health = std::make_unique<DriveHealthServer>(bus, objPath.c_str());
+    }
+    if (!data)
+    {
+        health->temperature(std::numeric_limits<double>::quiet_NaN());
+        health->ready(false);
+        return;
+    }
+    health->temperature(data->temperature
+                            ? *data->temperature
+                            : std::numeric_limits<double>::quiet_NaN());
+    health->criticalWarning(data->criticalWarning);
+    health->percentageDriveLifeUsed(data->lifeUsed);
+    health->ready(data->ready);
+    functional(data->functional);
 }
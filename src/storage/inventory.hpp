@@ -5,11 +5,47 @@
 
 #pragma once
 
+#include "com/yadro/HWManager/DriveHealth/server.hpp"
+#include "nvme_mi.hpp"
+#include "nvme_vpd.hpp"
+
 #include <xyz/openbmc_project/Inventory/Decorator/Asset/server.hpp>
 #include <xyz/openbmc_project/Inventory/Item/Drive/server.hpp>
 #include <xyz/openbmc_project/Inventory/Item/server.hpp>
 #include <xyz/openbmc_project/State/Decorator/OperationalStatus/server.hpp>
 
+#include <memory>
+#include <optional>
+
+using DriveHealthServer = sdbusplus::server::object::object<
+    sdbusplus::com::yadro::HWManager::server::DriveHealth>;
+
+/**
+ * @brief Storage drive information reported by the host
+ */
+struct StorageDriveInfo
+{
+    std::string path;      //!< device path on the host
+    std::string proto;     //!< protocol: SATA, SAS or NVMe
+    std::string type;      //!< drive type: SSD or HDD
+    std::string vendor;    //!< PCI vendor ID for NVMe drives
+    std::string model;     //!< drive model
+    std::string serial;    //!< drive serial number
+    std::string sizeBytes; //!< drive capacity in bytes
+
+    bool operator==(const StorageDriveInfo& right) const
+    {
+        return path == right.path && proto == right.proto &&
+               type == right.type && vendor == right.vendor &&
+               model == right.model && serial == right.serial &&
+               sizeBytes == right.sizeBytes;
+    }
+    bool operator!=(const StorageDriveInfo& right) const
+    {
+        return !(*this == right);
+    }
+};
+
 class StorageDrive :
     sdbusplus::server::object::object<
         sdbusplus::xyz::openbmc_project::Inventory::server::Item>,
@@ -22,8 +58,29 @@ class StorageDrive :
 {
   public:
     StorageDrive(sdbusplus::bus::bus& bus, const std::string& aName,
-                 const std::string& aPath, const std::string& aProto,
-                 const std::string& aType, const std::string& aVendor,
-                 const std::string& aModel, const std::string& aSerial,
-                 const std::string& aSizeBytes);
+                 const StorageDriveInfo& aInfo);
+
+    void update(const StorageDriveInfo& aInfo);
+    const std::string& getName() const
+    {
+        return name;
+    }
+
+    std::string getSerialNumber() const
+    {
+        return serialNumber();
+    }
+    void mergeAsset(const DriveVPD& vpd);
+    void updateHealth(const std::optional<NVMeHealth>& data);
+
+  private:
+    sdbusplus::bus::bus& bus;
+    std::string name;
+    std::string objPath;
+    StorageDriveInfo info;
+    std::string vendorName; //!< manufacturer name from PCI IDs database
+    DriveVPD vpd;
+
+    void updateAsset();
+    std::unique_ptr<DriveHealthServer> health;
 };
@@ -7,10 +7,15 @@
 #include "com/yadro/HWManager/StorageManager/server.hpp"
 #include "com/yadro/Inventory/Manager/server.hpp"
 #include "common.hpp"
+#include "common/async_call.hpp"
+#include "common/file_watcher.hpp"
 #include "common_i2c.hpp"
 #include "common_swupd.hpp"
 #include "dbus.hpp"
+#include "health_poller.hpp"
 #include "inventory.hpp"
+#include "reflasher.hpp"
+#include "state_snapshot.hpp"
 #include "xyz/openbmc_project/Common/error.hpp"
 #include "xyz/openbmc_project/Software/Version/server.hpp"
 
@@ -26,10 +31,15 @@
 #include <sdeventplus/source/signal.hpp>
 #include <sdeventplus/utility/timer.hpp>
 
+#include <algorithm>
+#include <deque>
 #include <filesystem>
 #include <fstream>
+#include <memory>
+#include <set>
 #include <streambuf>
 #include <string>
+#include <unordered_map>
 
 using namespace phosphor::logging;
 using namespace sdbusplus::xyz::openbmc_project::Common::Error;
@@ -40,8 +50,21 @@ constexpr auto clockId = sdeventplus::ClockId::RealTime;
 using Timer = sdeventplus::utility::Timer<clockId>;
 
 const std::chrono::seconds readConfigDelay(5);
+const std::chrono::seconds refreshPeriod(10);
+const std::chrono::seconds snapshotDelay(1);
+static constexpr uint64_t dbusTimeout = 5 * 1000 * 1000; // 5s
 
 static constexpr const char* storageDataFile = "/var/lib/inventory/storage.csv";
+static constexpr const char* stateSnapshotFile =
+    "/var/lib/yadro-storage-manager/state.bin";
+static constexpr const char* reflashConfigFile =
+    "/usr/share/obmc-yadro-hw/backplanes.json";
+
+static bool verifyDriveSN = true;
+/* NVMe drives health polling period, zero disables the polling */
+static std::chrono::seconds healthPollPeriod(0);
+/* Max number of drives health requests per second */
+static unsigned healthPollRate = 4;
 
 using InventoryManagerServer = sdbusplus::server::object_t<
     sdbusplus::com::yadro::Inventory::server::Manager>;
@@ -58,10 +81,26 @@ class Manager : InventoryManagerServer, StorageManagerServer
     std::tuple<std::string, std::string> findDrive(std::string driveSN);
     void setDriveLocationLED(std::string driveSN, bool assert);
     bool getDriveLocationLED(std::string driveSN);
+    std::vector<std::tuple<std::string, std::string, std::string, std::string>>
+        findDrives(std::vector<std::string> driveSNs);
+    std::vector<std::tuple<std::string, std::string>> setDriveLocationLEDs(
+        std::vector<std::tuple<std::string, bool>> requests);
+    std::vector<std::tuple<std::string, bool, std::string>>
+        getDriveLocationLEDs(std::vector<std::string> driveSNs);
+    void setSlotLocationLED(std::string backplane, std::string slot,
+                            bool assert);
+    bool getSlotLocationLED(std::string backplane, std::string slot);
+    std::tuple<std::string, std::string, bool>
+        getSlotStatus(std::string backplane, std::string slot);
     void resetDriveLocationLEDs();
 
+    void loadDrives();
+    void restoreState();
+    void reflash();
     void applyConfiguration();
-    void refresh();
+    void refresh(std::chrono::milliseconds maxAge =
+                     BackplaneController::refreshCoalesceTime);
+    void periodicRefresh();
 
   private:
     sdbusplus::bus::bus& bus;
@@ -69,11 +108,69 @@ class Manager : InventoryManagerServer, StorageManagerServer
     std::vector<std::unique_ptr<sdbusplus::bus::match_t>> matches;
     sdeventplus::utility::Timer<sdeventplus::ClockId::Monotonic> readDelayTimer;
     sdeventplus::utility::Timer<sdeventplus::ClockId::Monotonic> refreshTimer;
+    sdeventplus::utility::Timer<sdeventplus::ClockId::Monotonic> snapshotTimer;
+    sdeventplus::utility::Timer<sdeventplus::ClockId::Monotonic>
+        revalidateTimer;
+    UpdateScheduler updateScheduler;
     void softwareAdded(sdbusplus::message::message& msg);
 
-    std::vector<std::shared_ptr<StorageDrive>> drives;
+    /* Drives reported by the host, keyed by SN or device path */
+    std::map<std::string, std::shared_ptr<StorageDrive>> drives;
     std::map<std::string, std::shared_ptr<BackplaneController>> bplMCUs;
     std::map<std::string, std::shared_ptr<SoftwareObject>> software;
+    /* Controllers restored from the snapshot and not probed yet */
+    std::deque<std::string> unverifiedMCUs;
+    /* Controllers restored from the snapshot and not found in the
+     * configuration yet */
+    std::set<std::string> unconfiguredMCUs;
+
+    /* Configuration objects: object path -> controller name */
+    std::map<std::string, std::string> configPaths;
+    /* Configuration objects changed since the last reload */
+    std::set<std::string> changedConfigs;
+    /* Whether all the configuration objects are to be reloaded */
+    bool fullReload = false;
+    /* Pending GetManagedObjects request */
+    std::unique_ptr<common::AsyncCall> configCall;
+    /* Pending GetAll requests for the changed objects */
+    common::AsyncCallGroup configCalls;
+
+    void applyManagedObjects(const ManagedObjectType& objects);
+    void reloadConfiguration();
+    void checkConfigRace();
+    void configAdded(sdbusplus::message::message& msg);
+    void configRemoved(sdbusplus::message::message& msg);
+    void applyMCUConfig(const std::string& path, const DbusProperties& data);
+    void removeMCUConfig(const std::string& path);
+    void saveState();
+    void revalidate();
+    void reflashComplete(int i2cBus, int i2cAddr);
+    void addController(const std::string& name,
+                       std::shared_ptr<BackplaneController> mcu);
+    void removeController(const std::string& name);
+
+    /* Drive SN index: SN -> (backplane controller name, channel name) */
+    std::unordered_map<std::string, std::pair<std::string, std::string>>
+        driveIndex;
+    /* SNs indexed for each backplane controller */
+    std::map<std::string, std::vector<std::string>> indexedSNs;
+    void updateDriveIndex(const std::string& mcuName,
+                          const BackplaneController::DrivesList& drivesState);
+    void updateDrivesAsset();
+    std::vector<HealthPoller::Target> healthTargets();
+    void updateDriveHealth(const std::string& driveSN,
+                           const std::optional<NVMeHealth>& health);
+    std::unique_ptr<HealthPoller> healthPoller;
+    std::unique_ptr<common::FileWatcher> dataFileWatcher;
+    using DriveLocation =
+        std::pair<std::shared_ptr<BackplaneController>, std::string>;
+    DriveLocation lookupDrive(const std::string& driveSN);
+    DriveLocation lookupDriveIndex(const std::string& driveSN);
+    DriveLocation lookupDriveIndexUnverified(const std::string& driveSN) const;
+    std::vector<std::pair<DriveLocation, std::string>>
+        lookupDrives(const std::vector<std::string>& driveSNs);
+    std::shared_ptr<BackplaneController>
+        lookupSlot(const std::string& backplane, const std::string& slot);
 
     void hostPowerChanged(bool powered);
     PowerState powerState;
@@ -100,9 +197,14 @@ Manager::Manager(sdbusplus::bus::bus& bus, sdeventplus::Event& event) :
     StorageManagerServer(bus, dbus::stormgr::path), bus(bus), event(event),
     powerState(bus),
     readDelayTimer(event,
-                   std::bind(std::mem_fn(&Manager::applyConfiguration), this)),
-    refreshTimer(event, std::bind(std::mem_fn(&Manager::refresh), this),
-                 std::chrono::seconds(10))
+                   std::bind(std::mem_fn(&Manager::reloadConfiguration), this)),
+    refreshTimer(event,
+                 std::bind(std::mem_fn(&Manager::periodicRefresh), this),
+                 refreshPeriod),
+    snapshotTimer(event, std::bind(std::mem_fn(&Manager::saveState), this)),
+    revalidateTimer(event,
+                    std::bind(std::mem_fn(&Manager::revalidate), this)),
+    updateScheduler(event), configCalls(bus, dbusTimeout)
 {
     matches.emplace_back(std::make_unique<sdbusplus::bus::match_t>(
         bus,
@@ -110,145 +212,483 @@ Manager::Manager(sdbusplus::bus::bus& bus, sdeventplus::Event& event) :
             sdbusRule::path_namespace(dbus::inventory::pathBase) +
             sdbusRule::argN(0, dbus::configuration::bplmcu::interface) +
             sdbusRule::interface(dbus::properties::interface),
-        [this](sdbusplus::message::message&) {
+        [this](sdbusplus::message::message& msg) {
+            // the changes usually come in bursts, so they are coalesced
+            changedConfigs.insert(msg.get_path());
             readDelayTimer.restartOnce(readConfigDelay);
         }));
+    matches.emplace_back(std::make_unique<sdbusplus::bus::match_t>(
+        bus,
+        sdbusRule::interfacesAdded() +
+            sdbusRule::sender(dbus::configuration::busName),
+        [this](sdbusplus::message::message& msg) { configAdded(msg); }));
+    matches.emplace_back(std::make_unique<sdbusplus::bus::match_t>(
+        bus,
+        sdbusRule::interfacesRemoved() +
+            sdbusRule::sender(dbus::configuration::busName),
+        [this](sdbusplus::message::message& msg) { configRemoved(msg); }));
     matches.emplace_back(std::make_unique<sdbusplus::bus::match_t>(
         bus,
         sdbusRule::interfacesAdded() + sdbusRule::path(dbus::software::path),
         [this](sdbusplus::message::message& msg) { softwareAdded(msg); }));
+
+    try
+    {
+        dataFileWatcher = std::make_unique<common::FileWatcher>(
+            event, storageDataFile, [this]() { loadDrives(); });
+    }
+    catch (const std::exception& ex)
+    {
+        log<level::ERR>("failed to watch storage data file",
+                        entry("VALUE=%s", storageDataFile),
+                        entry("ERROR=%s", ex.what()));
+    }
+
+    if (healthPollPeriod.count() > 0)
+    {
+        healthPoller = std::make_unique<HealthPoller>(
+            event, healthPollPeriod, healthPollRate,
+            [this]() { return healthTargets(); },
+            [this](const std::string& driveSN,
+                   const std::optional<NVMeHealth>& health) {
+                updateDriveHealth(driveSN, health);
+            });
+    }
 }
 
-void Manager::applyConfiguration()
+void Manager::addController(const std::string& name,
+                            std::shared_ptr<BackplaneController> mcu)
 {
-    bool softwarePowerGoodRequested = false;
-    SubTreeType objects;
-    auto getObjects =
-        bus.new_method_call(dbus::mapper::busName, dbus::mapper::path,
-                            dbus::mapper::interface, dbus::mapper::subtree);
-    getObjects.append(
-        dbus::inventory::pathBase, 0,
-        std::array<std::string, 1>{dbus::configuration::bplmcu::interface});
+    bplMCUs[name] = mcu;
+    mcu->setDrivesObserver(std::bind(&Manager::updateDriveIndex, this,
+                                     std::placeholders::_1,
+                                     std::placeholders::_2));
+}
 
-    try
+void Manager::removeController(const std::string& name)
+{
+    auto it = bplMCUs.find(name);
+    if (it == bplMCUs.end())
     {
-        log<level::DEBUG>(
-            "Calling GetSubTree for YadroBackplaneMCU configuration");
-        bus.call(getObjects /*, dbusTimeout*/).read(objects);
-        log<level::DEBUG>("GetSubTree call done");
+        return;
     }
-    catch (const sdbusplus::exception::SdBusError& ex)
+    log<level::INFO>("Backplane controller removed",
+                     entry("NAME=%s", name.c_str()));
+    updateDriveIndex(name, BackplaneController::DrivesList());
+    indexedSNs.erase(name);
+    bplMCUs.erase(it);
+}
+
+/**
+ * @brief Publish the last known backplanes state saved before the restart
+ *
+ * The restored controllers are marked as unverified and are probed in the
+ * background one by one.
+ */
+void Manager::restoreState()
+{
+    for (auto& mcu : loadSnapshot(stateSnapshotFile))
+    {
+        if (bplMCUs.find(mcu.name) != bplMCUs.end())
+        {
+            continue;
+        }
+        addController(mcu.name,
+                      std::make_shared<BackplaneController>(
+                          bus, mcu.i2cBus, mcu.i2cAddr, mcu.name, mcu.config,
+                          mcu.inventory, updateScheduler, mcu.state));
+        unverifiedMCUs.push_back(mcu.name);
+        unconfiguredMCUs.insert(mcu.name);
+    }
+    if (!unverifiedMCUs.empty())
+    {
+        log<level::INFO>("Backplanes state restored",
+                         entry("COUNT=%zu", unverifiedMCUs.size()));
+        revalidateTimer.restartOnce(std::chrono::milliseconds(0));
+    }
+}
+
+/**
+ * @brief Probe the next restored controller, the event loop is released
+ *        between the controllers
+ */
+void Manager::revalidate()
+{
+    if (unverifiedMCUs.empty())
     {
-        log<level::ERR>("Error while calling GetSubTree",
-                        entry("WHAT=%s", ex.what()));
         return;
     }
+    const std::string name = unverifiedMCUs.front();
+    unverifiedMCUs.pop_front();
+    auto it = bplMCUs.find(name);
+    // MCU being reflashed is probed when the reflash is completed
+    if (it != bplMCUs.end() && !it->second->isVerified() &&
+        !it->second->isUpdating())
+    {
+        try
+        {
+            it->second->refresh(std::chrono::milliseconds(0));
+        }
+        catch (const std::exception& e)
+        {
+            log<level::ERR>("Failed to refresh backplane",
+                            entry("NAME=%s", name.c_str()),
+                            entry("REASON=%s", e.what()));
+        }
+    }
+    if (!unverifiedMCUs.empty())
+    {
+        revalidateTimer.restartOnce(std::chrono::milliseconds(0));
+    }
+}
 
-    for (const auto& [path, objDict] : objects)
+/**
+ * @brief Detect backplanes and queue reflash of the outdated MCUs
+ *
+ * The reflash is performed in the background by the update scheduler, only
+ * the MCUs being flashed are busy, others are fully functional.
+ */
+void Manager::reflash()
+{
+    Reflasher reflasher;
+    reflasher.loadConfig(reflashConfigFile);
+    for (const auto& target : reflasher.findTargets())
     {
-        const std::string& owner = objDict.begin()->first;
-        DbusProperties data;
-        auto getProperties = bus.new_method_call(owner.c_str(), path.c_str(),
-                                                 dbus::properties::interface,
-                                                 dbus::properties::getAll);
-        getProperties.append(dbus::configuration::bplmcu::interface);
+        log<level::INFO>("Backplane shred found",
+                         entry("SHRED=%s", target.shred.c_str()),
+                         entry("CHIP=%s", target.chip.c_str()),
+                         entry("BUS=%d", target.bus),
+                         entry("FIRMWARE=%s", target.firmware.c_str()));
+        if (target.firmware.empty())
+        {
+            continue;
+        }
+        for (const auto& addr : target.addrs)
+        {
+            UpdateScheduler::Request request;
+            request.devPath = "/dev/i2c-" + std::to_string(target.bus);
+            request.addr = addr;
+            request.imagePath = target.firmware;
+            request.imageVersion = target.version;
+            request.mode = target.required
+                               ? UpdateWorker::Mode::Reflash
+                               : UpdateWorker::Mode::ReflashIfPresent;
+            request.onComplete = [this, bus = target.bus, addr](bool) {
+                reflashComplete(bus, addr);
+            };
+            updateScheduler.submit(std::move(request));
+        }
+    }
+}
 
+/**
+ * @brief Probe the controller of the reflashed MCU
+ */
+void Manager::reflashComplete(int i2cBus, int i2cAddr)
+{
+    for (const auto& [name, mcu] : bplMCUs)
+    {
+        if (mcu->getI2CBus() != i2cBus || mcu->getI2CAddr() != i2cAddr)
+        {
+            continue;
+        }
+        mcu->invalidate();
         try
         {
-            log<level::DEBUG>("Calling GetAll for YadroBackplaneMCU object");
-            bus.call(getProperties /*, dbusTimeout*/).read(data);
-            log<level::DEBUG>("GetAll call done");
+            mcu->refresh();
         }
-        catch (const sdbusplus::exception::exception& ex)
+        catch (const std::exception& e)
         {
-            log<level::ERR>(
-                "Error while calling GetAll",
-                entry("SERVICE=%s", owner.c_str()),
-                entry("PATH=%s", path.c_str()),
-                entry("INTERFACE=%s", dbus::configuration::bplmcu::interface),
-                entry("WHAT=%s", ex.description()));
-            return;
+            log<level::ERR>("Failed to refresh backplane",
+                            entry("NAME=%s", name.c_str()),
+                            entry("REASON=%s", e.what()));
         }
+    }
+}
 
-        uint64_t i2cBus(std::numeric_limits<uint64_t>::max());
-        uint64_t i2cAddr(std::numeric_limits<uint64_t>::max());
-        std::map<int, std::string> channels;
-        bool haveDriveI2C(false);
-        bool softwarePowerGood(false);
+/**
+ * @brief Save backplanes state to be restored on the next start
+ */
+void Manager::saveState()
+{
+    std::vector<ControllerSnapshot> controllers;
+    for (const auto& [name, mcu] : bplMCUs)
+    {
+        ControllerSnapshot snapshot;
+        snapshot.name = name;
+        snapshot.i2cBus = mcu->getI2CBus();
+        snapshot.i2cAddr = mcu->getI2CAddr();
+        snapshot.inventory = mcu->getInventory();
+        snapshot.config = mcu->getConfig();
+        snapshot.state = mcu->getState();
+        controllers.push_back(std::move(snapshot));
+    }
+    saveSnapshot(stateSnapshotFile, controllers);
+}
 
-        for (const auto& [prop, value] : data)
-        {
-            if (prop == dbus::configuration::bplmcu::properties::bus)
-            {
-                i2cBus = std::get<uint64_t>(value);
-            }
-            else if (prop == dbus::configuration::bplmcu::properties::addr)
+/**
+ * @brief Load configuration of all backplane MCUs
+ *
+ * All the configuration objects are read with a single call, the later
+ * changes are tracked per object by the signal handlers.
+ */
+void Manager::applyConfiguration()
+{
+    auto getObjects = bus.new_method_call(
+        dbus::configuration::busName, dbus::configuration::path,
+        dbus::objmgr::interface, dbus::objmgr::managedObjects);
+    log<level::DEBUG>("Calling GetManagedObjects for configuration");
+    configCall = std::make_unique<common::AsyncCall>(
+        bus, getObjects,
+        [this](sdbusplus::message::message& reply) {
+            configCall.reset();
+            if (common::AsyncCall::isError(reply))
             {
-                i2cAddr = std::get<uint64_t>(value);
+                log<level::ERR>(
+                    "Error while calling GetManagedObjects",
+                    entry("SERVICE=%s", dbus::configuration::busName),
+                    entry("PATH=%s", dbus::configuration::path),
+                    entry("WHAT=%s",
+                          common::AsyncCall::errorMessage(reply).c_str()));
+                fullReload = true;
+                readDelayTimer.restartOnce(readConfigDelay);
+                return;
             }
-            else if (prop == dbus::configuration::bplmcu::properties::channels)
-            {
-                std::vector<std::string> tmp;
-                tmp = std::get<std::vector<std::string>>(value);
-                int chanIndex = 0;
-                for (const auto& chan : tmp)
+
+            ManagedObjectType objects;
+            reply.read(objects);
+            log<level::DEBUG>("GetManagedObjects call done");
+            applyManagedObjects(objects);
+        },
+        dbusTimeout);
+}
+
+/**
+ * @brief Apply configuration of all backplane MCUs
+ *
+ * @param[in] objects - all the configuration objects
+ */
+void Manager::applyManagedObjects(const ManagedObjectType& objects)
+{
+    std::set<std::string> found;
+    for (const auto& [path, interfaces] : objects)
+    {
+        const auto it =
+            interfaces.find(dbus::configuration::bplmcu::interface);
+        if (it != interfaces.end())
+        {
+            applyMCUConfig(path.str, it->second);
+            found.insert(path.str);
+        }
+    }
+
+    // the objects removed while the signals were not handled
+    std::vector<std::string> removed;
+    for (const auto& [path, _] : configPaths)
+    {
+        if (found.find(path) == found.end())
+        {
+            removed.push_back(path);
+        }
+    }
+    for (const auto& path : removed)
+    {
+        removeMCUConfig(path);
+    }
+
+    // the configuration has been changed since the snapshot was taken
+    for (const auto& name : unconfiguredMCUs)
+    {
+        removeController(name);
+    }
+    unconfiguredMCUs.clear();
+}
+
+/**
+ * @brief Reload configuration objects changed since the last reload
+ */
+void Manager::reloadConfiguration()
+{
+    if (fullReload)
+    {
+        fullReload = false;
+        changedConfigs.clear();
+        configCalls.cancel();
+        applyConfiguration();
+        return;
+    }
+
+    configCalls.cancel();
+    for (const auto& path : changedConfigs)
+    {
+        auto getProperties = bus.new_method_call(
+            dbus::configuration::busName, path.c_str(),
+            dbus::properties::interface, dbus::properties::getAll);
+        getProperties.append(dbus::configuration::bplmcu::interface);
+        log<level::DEBUG>("Calling GetAll for YadroBackplaneMCU object",
+                          entry("PATH=%s", path.c_str()));
+        configCalls.call(
+            getProperties, [this, path](sdbusplus::message::message& reply) {
+                if (common::AsyncCall::isError(reply))
                 {
-                    // skip channel if the name is not specified in config
-                    if (!chan.empty())
-                    {
-                        channels[chanIndex] = chan;
-                    }
-                    chanIndex++;
+                    log<level::ERR>(
+                        "Error while calling GetAll",
+                        entry("SERVICE=%s", dbus::configuration::busName),
+                        entry("PATH=%s", path.c_str()),
+                        entry("INTERFACE=%s",
+                              dbus::configuration::bplmcu::interface),
+                        entry("WHAT=%s",
+                              common::AsyncCall::errorMessage(reply).c_str()));
+                    return;
                 }
-            }
-            else if (prop ==
-                     dbus::configuration::bplmcu::properties::haveDriveI2C)
-            {
-                haveDriveI2C = std::get<bool>(value);
-            }
-            else if (prop ==
-                     dbus::configuration::bplmcu::properties::softwarePowerGood)
+
+                DbusProperties data;
+                reply.read(data);
+                log<level::DEBUG>("GetAll call done",
+                                  entry("PATH=%s", path.c_str()));
+                applyMCUConfig(path, data);
+            });
+    }
+    changedConfigs.clear();
+}
+
+/**
+ * @brief Schedule the full reload if the signal races with GetManagedObjects
+ *
+ * The pending reply may be older than the signal, so it can't be trusted.
+ */
+void Manager::checkConfigRace()
+{
+    if (configCall)
+    {
+        fullReload = true;
+        readDelayTimer.restartOnce(readConfigDelay);
+    }
+}
+
+void Manager::configAdded(sdbusplus::message::message& msg)
+{
+    sdbusplus::message::object_path path;
+    std::map<Interface, DbusProperties> interfaces;
+    msg.read(path, interfaces);
+
+    const auto it = interfaces.find(dbus::configuration::bplmcu::interface);
+    if (it != interfaces.end())
+    {
+        applyMCUConfig(path.str, it->second);
+        changedConfigs.erase(path.str);
+        checkConfigRace();
+    }
+}
+
+void Manager::configRemoved(sdbusplus::message::message& msg)
+{
+    sdbusplus::message::object_path path;
+    std::vector<Interface> interfaces;
+    msg.read(path, interfaces);
+
+    if (std::find(interfaces.begin(), interfaces.end(),
+                  dbus::configuration::bplmcu::interface) != interfaces.end())
+    {
+        removeMCUConfig(path.str);
+        changedConfigs.erase(path.str);
+        checkConfigRace();
+    }
+}
+
+/**
+ * @brief Create or update the backplane controller from its configuration
+ *
+ * @param[in] path - configuration object path
+ * @param[in] data - YadroBackplaneMCU interface properties
+ */
+void Manager::applyMCUConfig(const std::string& path,
+                             const DbusProperties& data)
+{
+    uint64_t i2cBus(std::numeric_limits<uint64_t>::max());
+    uint64_t i2cAddr(std::numeric_limits<uint64_t>::max());
+    std::map<int, std::string> channels;
+    bool haveDriveI2C(false);
+    bool softwarePowerGood(false);
+
+    for (const auto& [prop, value] : data)
+    {
+        if (prop == dbus::configuration::bplmcu::properties::bus)
+        {
+            i2cBus = std::get<uint64_t>(value);
+        }
+        else if (prop == dbus::configuration::bplmcu::properties::addr)
+        {
+            i2cAddr = std::get<uint64_t>(value);
+        }
+        else if (prop == dbus::configuration::bplmcu::properties::channels)
+        {
+            std::vector<std::string> tmp;
+            tmp = std::get<std::vector<std::string>>(value);
+            int chanIndex = 0;
+            for (const auto& chan : tmp)
             {
-                softwarePowerGood = std::get<bool>(value);
-                if (softwarePowerGood)
+                // skip channel if the name is not specified in config
+                if (!chan.empty())
                 {
-                    softwarePowerGoodRequested = true;
+                    channels[chanIndex] = chan;
                 }
+                chanIndex++;
             }
         }
-
-        if ((i2cBus == std::numeric_limits<uint64_t>::max()) ||
-            (i2cAddr == std::numeric_limits<uint64_t>::max()))
+        else if (prop == dbus::configuration::bplmcu::properties::haveDriveI2C)
         {
-            log<level::ERR>(
-                "Required fields not specified for backplane MCU",
-                entry("SERVICE=%s", owner.c_str()),
-                entry("PATH=%s", path.c_str()),
-                entry("INTERFACE=%s", dbus::configuration::bplmcu::interface),
-                entry("BUS=%llu", i2cBus), entry("ADDR=%llu", i2cAddr));
-            continue;
+            haveDriveI2C = std::get<bool>(value);
         }
-        BackplaneControllerConfig config = {.channels = channels,
-                                            .haveDriveI2C = haveDriveI2C,
-                                            .softwarePowerGood =
-                                                softwarePowerGood};
-        std::ostringstream ss;
-        ss << "MCU_" << i2cBus << "_" << std::hex << i2cAddr;
-        const std::string name = ss.str();
-
-        auto it = bplMCUs.find(name);
-        if (it == bplMCUs.end())
+        else if (prop ==
+                 dbus::configuration::bplmcu::properties::softwarePowerGood)
         {
-            fs::path p(path);
-            bplMCUs[name] = std::make_shared<BackplaneController>(
-                bus, i2cBus, i2cAddr, name, config, p.parent_path().string());
-        }
-        else
-        {
-            it->second->updateConfig(config);
+            softwarePowerGood = std::get<bool>(value);
         }
     }
-    if (softwarePowerGoodRequested)
+
+    if ((i2cBus == std::numeric_limits<uint64_t>::max()) ||
+        (i2cAddr == std::numeric_limits<uint64_t>::max()))
+    {
+        log<level::ERR>(
+            "Required fields not specified for backplane MCU",
+            entry("PATH=%s", path.c_str()),
+            entry("INTERFACE=%s", dbus::configuration::bplmcu::interface),
+            entry("BUS=%llu", i2cBus), entry("ADDR=%llu", i2cAddr));
+        removeMCUConfig(path);
+        return;
+    }
+    BackplaneControllerConfig config = {.channels = channels,
+                                        .haveDriveI2C = haveDriveI2C,
+                                        .softwarePowerGood =
+                                            softwarePowerGood};
+    std::ostringstream ss;
+    ss << "MCU_" << i2cBus << "_" << std::hex << i2cAddr;
+    const std::string name = ss.str();
+
+    // the address has been changed
+    const auto cfgIt = configPaths.find(path);
+    if (cfgIt != configPaths.end() && cfgIt->second != name)
+    {
+        removeMCUConfig(path);
+    }
+    configPaths[path] = name;
+
+    unconfiguredMCUs.erase(name);
+    auto it = bplMCUs.find(name);
+    if (it == bplMCUs.end())
+    {
+        fs::path p(path);
+        addController(name, std::make_shared<BackplaneController>(
+                                bus, i2cBus, i2cAddr, name, config,
+                                p.parent_path().string(), updateScheduler));
+    }
+    else
+    {
+        it->second->updateConfig(config);
+    }
+
+    if (softwarePowerGood)
     {
         powerState.addCallback(
             "manager",
@@ -256,17 +696,55 @@ void Manager::applyConfiguration()
     }
 }
 
-void Manager::refresh()
+/**
+ * @brief Remove the backplane controller of the configuration object
+ *
+ * @param[in] path - configuration object path
+ */
+void Manager::removeMCUConfig(const std::string& path)
 {
-    try
+    const auto it = configPaths.find(path);
+    if (it == configPaths.end())
     {
-        for (const auto& [_, mcu] : bplMCUs)
+        return;
+    }
+    const std::string name = it->second;
+    configPaths.erase(it);
+    for (const auto& [_, mcuName] : configPaths)
+    {
+        if (mcuName == name)
         {
-            mcu->refresh();
+            // the same MCU is still configured by another object
+            return;
+        }
+    }
+    removeController(name);
+}
+
+void Manager::refresh(std::chrono::milliseconds maxAge)
+{
+    for (const auto& [_, mcu] : bplMCUs)
+    {
+        try
+        {
+            mcu->refresh(maxAge);
+        }
+        catch (...)
+        {
+            // the backplane is busy or broken, others are still refreshed
         }
     }
-    catch (...)
-    {}
+}
+
+/**
+ * @brief Refresh timer handler
+ *
+ * The backplanes refreshed by user requests within the last half of the
+ * period are skipped.
+ */
+void Manager::periodicRefresh()
+{
+    refresh(refreshPeriod / 2);
 }
 
 /**
@@ -366,22 +844,44 @@ void Manager::softwareAdded(sdbusplus::message::message& msg)
 }
 
 /**
- * @brief Find storage drives information and create corresponding dbus objects
+ * @brief Re-read storage drives information, drives VPD is read again as well
  *
  */
 void Manager::rescan()
+{
+    for (const auto& [_, mcu] : bplMCUs)
+    {
+        mcu->rescanDrives();
+    }
+    loadDrives();
+}
+
+/**
+ * @brief Find storage drives information and create corresponding dbus objects
+ *
+ */
+void Manager::loadDrives()
 {
     std::ifstream dataFile(storageDataFile);
     std::string line;
     if (!dataFile.is_open())
     {
-        log<level::ERR>("failed to open file",
-                        entry("VALUE=%s", storageDataFile));
-        return;
+        std::error_code ec;
+        if (fs::exists(storageDataFile, ec) || ec)
+        {
+            log<level::ERR>("failed to open file",
+                            entry("VALUE=%s", storageDataFile));
+            return;
+        }
+        // the host has removed the file, so the drives it has reported
+        // before are not known anymore
+        log<level::INFO>("storage data file is missing, drives are dropped",
+                         entry("VALUE=%s", storageDataFile));
     }
 
-    size_t index = 1;
-    drives.clear();
+    // drives are keyed by SN, the device path is used if SN is unknown
+    std::vector<std::pair<std::string, StorageDriveInfo>> entries;
+    std::set<std::string> keys;
     while (std::getline(dataFile, line))
     {
         std::vector<std::string> entryFields;
@@ -397,75 +897,537 @@ void Manager::rescan()
                             entry("VALUE=%s", line.c_str()));
             return;
         }
-        drives.emplace_back(std::make_shared<StorageDrive>(
-            bus, "drive " + std::to_string(index), entryFields[path],
-            entryFields[proto], entryFields[type], entryFields[vendor],
-            entryFields[model], entryFields[serial], entryFields[sizeBytes]));
-        index++;
+        StorageDriveInfo info;
+        info.path = entryFields[path];
+        info.proto = entryFields[proto];
+        info.type = entryFields[type];
+        info.vendor = entryFields[vendor];
+        info.model = entryFields[model];
+        info.serial = entryFields[serial];
+        info.sizeBytes = entryFields[sizeBytes];
+        std::string key = info.serial.empty() ? "path:" + info.path
+                                              : "sn:" + info.serial;
+        if (!keys.insert(key).second)
+        {
+            log<level::ERR>("duplicate drive entry",
+                            entry("VALUE=%s", line.c_str()));
+            continue;
+        }
+        entries.emplace_back(std::move(key), std::move(info));
+    }
+
+    // only the real changes are published: removed drives are dropped first
+    // to release their names, existing ones are updated in place
+    std::set<std::string> names;
+    for (auto it = drives.begin(); it != drives.end();)
+    {
+        if (keys.count(it->first))
+        {
+            names.insert(it->second->getName());
+            ++it;
+        }
+        else
+        {
+            it = drives.erase(it);
+        }
+    }
+
+    size_t index = 1;
+    for (const auto& [key, info] : entries)
+    {
+        auto it = drives.find(key);
+        if (it != drives.end())
+        {
+            it->second->update(info);
+            continue;
+        }
+        std::string name;
+        do
+        {
+            name = "drive " + std::to_string(index++);
+        } while (names.count(name));
+        names.insert(name);
+        drives.emplace(key, std::make_shared<StorageDrive>(bus, name, info));
     }
+    updateDrivesAsset();
 }
 
-std::tuple<std::string, std::string> Manager::findDrive(std::string driveSN)
+void Manager::updateDriveIndex(
+    const std::string& mcuName,
+    const BackplaneController::DrivesList& drivesState)
+{
+    auto& snList = indexedSNs[mcuName];
+    for (const auto& sn : snList)
+    {
+        auto it = driveIndex.find(sn);
+        if (it != driveIndex.end() && it->second.first == mcuName)
+        {
+            driveIndex.erase(it);
+        }
+    }
+    snList.clear();
+
+    for (const auto& [chanName, sn, driveIface, failure] : drivesState)
+    {
+        if (!sn.empty())
+        {
+            driveIndex[sn] = std::make_pair(mcuName, chanName);
+            snList.push_back(sn);
+        }
+    }
+    updateDrivesAsset();
+    snapshotTimer.restartOnce(snapshotDelay);
+}
+
+/**
+ * @brief Get the list of NVMe drives to poll health of
+ *
+ * Only the drives with a known slot are polled, the drive SN is used as the
+ * identifier.
+ */
+std::vector<HealthPoller::Target> Manager::healthTargets()
+{
+    std::vector<HealthPoller::Target> targets;
+    for (const auto& [_, drive] : drives)
+    {
+        const std::string sn = drive->getSerialNumber();
+        const auto it = driveIndex.find(sn);
+        if (it == driveIndex.end())
+        {
+            continue;
+        }
+        const std::string devPath = getBusByChanName(it->second.second);
+        if (!devPath.empty())
+        {
+            HealthPoller::Target target;
+            target.id = sn;
+            target.devPath = devPath;
+            targets.push_back(std::move(target));
+        }
+    }
+    return targets;
+}
+
+void Manager::updateDriveHealth(const std::string& driveSN,
+                                const std::optional<NVMeHealth>& health)
+{
+    for (const auto& [_, drive] : drives)
+    {
+        if (drive->getSerialNumber() == driveSN)
+        {
+            drive->updateHealth(health);
+        }
+    }
+}
+
+/**
+ * @brief Merge the drives VPD data read by backplane controllers into the
+ *        drives inventory
+ */
+void Manager::updateDrivesAsset()
+{
+    for (const auto& [_, drive] : drives)
+    {
+        const auto it = driveIndex.find(drive->getSerialNumber());
+        if (it == driveIndex.end())
+        {
+            continue;
+        }
+        const auto& [mcuName, chanName] = it->second;
+        const auto mcu = bplMCUs.find(mcuName);
+        if (mcu == bplMCUs.end())
+        {
+            continue;
+        }
+        const auto* vpd = mcu->second->cachedDriveVPD(chanName);
+        if (vpd)
+        {
+            drive->mergeAsset(*vpd);
+        }
+    }
+}
+
+/**
+ * @brief Lookup the drive in the SN index without verification
+ *
+ * @return backplane controller and channel name, nullptr if not indexed
+ */
+Manager::DriveLocation
+    Manager::lookupDriveIndexUnverified(const std::string& driveSN) const
+{
+    auto it = driveIndex.find(driveSN);
+    if (it == driveIndex.end())
+    {
+        return {};
+    }
+    const auto& [mcuName, chanName] = it->second;
+    auto mcu = bplMCUs.find(mcuName);
+    if (mcu == bplMCUs.end())
+    {
+        return {};
+    }
+    return std::make_pair(mcu->second, chanName);
+}
+
+/**
+ * @brief Lookup the drive in the SN index
+ *
+ * @return backplane controller and channel name, nullptr if not indexed or
+ *         the index entry is stale
+ */
+Manager::DriveLocation Manager::lookupDriveIndex(const std::string& driveSN)
+{
+    auto location = lookupDriveIndexUnverified(driveSN);
+    const auto& [mcu, chanName] = location;
+    if (mcu && verifyDriveSN && !mcu->verifyDriveSN(chanName, driveSN))
+    {
+        // the drive was replaced, refresh the index for this backplane
+        mcu->refresh();
+        return {};
+    }
+    return location;
+}
+
+/**
+ * @brief Find the backplane slot where the drive is installed
+ *
+ * The SN index is maintained by backplane controllers on drives presence
+ * changes. The indexed slot is verified against the cached VPD, which costs
+ * a single MCU state poll (shared by the lookups within the refresh coalesce
+ * time). The drive VPD is read over I2C only if the drive has been replaced
+ * or the MCU can't report replacements (protocol v0). Backplanes are
+ * refreshed only if the drive is not indexed.
+ *
+ * @return backplane controller and channel name
+ */
+Manager::DriveLocation Manager::lookupDrive(const std::string& driveSN)
 {
     if (driveSN.empty())
     {
         throw InvalidArgument();
     }
-    for (const auto& [_, mcu] : bplMCUs)
+
+    auto location = lookupDriveIndex(driveSN);
+    if (location.first)
+    {
+        return location;
+    }
+
+    // the drive might be inserted after the last refresh
+    refresh();
+
+    location = lookupDriveIndex(driveSN);
+    if (!location.first)
+    {
+        throw ResourceNotFound();
+    }
+    return location;
+}
+
+std::tuple<std::string, std::string> Manager::findDrive(std::string driveSN)
+{
+    const auto [mcu, chanName] = lookupDrive(driveSN);
+    auto found = chanName.find('_');
+    if (found != std::string::npos)
     {
-        auto chanName = mcu->findChannelByDriveSN(driveSN);
-        if (!chanName.empty())
+        std::string type = chanName.substr(0, found);
+        std::string name = chanName.substr(found + 1);
+        return std::make_tuple(type, name);
+    }
+    return std::make_tuple(std::string(), chanName);
+}
+
+void Manager::setDriveLocationLED(std::string driveSN, bool assert)
+{
+    const auto [mcu, chanName] = lookupDrive(driveSN);
+    mcu->setDriveLocationLED(chanName, assert);
+}
+
+bool Manager::getDriveLocationLED(std::string driveSN)
+{
+    const auto [mcu, chanName] = lookupDrive(driveSN);
+    return mcu->getDriveLocationLED(chanName);
+}
+
+/**
+ * @brief Find the backplane slots for several drives at once
+ *
+ * Backplanes are refreshed at most once for the whole list, the drives
+ * indexed on the same backplane are verified in a single pass.
+ *
+ * @return locations in the order of \p driveSNs, the location is empty and
+ *         the error name is set if the drive can't be found
+ */
+std::vector<std::pair<Manager::DriveLocation, std::string>>
+    Manager::lookupDrives(const std::vector<std::string>& driveSNs)
+{
+    std::vector<std::pair<DriveLocation, std::string>> result(
+        driveSNs.size());
+    bool missed = false;
+
+    auto lookup = [&](bool lastTry) {
+        // indexes of the drives to verify, grouped by backplanes
+        std::map<std::shared_ptr<BackplaneController>, std::vector<size_t>>
+            batches;
+        for (size_t i = 0; i < driveSNs.size(); ++i)
+        {
+            auto& [location, error] = result[i];
+            if (location.first || !error.empty())
+            {
+                continue;
+            }
+            if (driveSNs[i].empty())
+            {
+                error = InvalidArgument().name();
+                continue;
+            }
+            location = lookupDriveIndexUnverified(driveSNs[i]);
+            if (location.first && verifyDriveSN)
+            {
+                batches[location.first].push_back(i);
+            }
+        }
+
+        for (const auto& [mcu, indexes] : batches)
         {
-            auto found = chanName.find('_');
-            if (found != std::string::npos)
+            std::vector<std::pair<std::string, std::string>> drives;
+            for (const auto i : indexes)
+            {
+                drives.emplace_back(result[i].first.second, driveSNs[i]);
+            }
+            try
+            {
+                const auto matches = mcu->verifyDrivesSN(drives);
+                bool replaced = false;
+                for (size_t j = 0; j < indexes.size(); ++j)
+                {
+                    if (!matches[j])
+                    {
+                        result[indexes[j]].first = {};
+                        replaced = true;
+                    }
+                }
+                if (replaced)
+                {
+                    // refresh the index for this backplane
+                    mcu->refresh();
+                }
+            }
+            catch (const sdbusplus::exception::exception& e)
+            {
+                for (const auto i : indexes)
+                {
+                    result[i] = {{}, e.name()};
+                }
+            }
+            catch (const std::exception& e)
             {
-                std::string type = chanName.substr(0, found);
-                std::string name = chanName.substr(found + 1);
-                return std::make_tuple(type, name);
+                log<level::ERR>("Failed to verify drives",
+                                entry("ERROR=%s", e.what()));
+                for (const auto i : indexes)
+                {
+                    result[i] = {{}, InternalFailure().name()};
+                }
             }
-            else
+        }
+
+        for (auto& [location, error] : result)
+        {
+            if (!location.first && error.empty())
             {
-                return std::make_tuple(std::string(), chanName);
+                missed = true;
+                if (lastTry)
+                {
+                    error = ResourceNotFound().name();
+                }
             }
         }
+    };
+
+    lookup(false);
+    if (missed)
+    {
+        // some drives might be inserted after the last refresh
+        refresh();
+        lookup(true);
     }
-    throw ResourceNotFound();
+    return result;
 }
 
-void Manager::setDriveLocationLED(std::string driveSN, bool assert)
+std::vector<std::tuple<std::string, std::string, std::string, std::string>>
+    Manager::findDrives(std::vector<std::string> driveSNs)
 {
-    if (driveSN.empty())
+    std::vector<std::tuple<std::string, std::string, std::string, std::string>>
+        result;
+    const auto locations = lookupDrives(driveSNs);
+    for (size_t i = 0; i < driveSNs.size(); ++i)
     {
-        throw InvalidArgument();
+        const auto& [location, error] = locations[i];
+        const std::string& chanName = location.second;
+        std::string type;
+        std::string name = chanName;
+        auto found = chanName.find('_');
+        if (found != std::string::npos)
+        {
+            type = chanName.substr(0, found);
+            name = chanName.substr(found + 1);
+        }
+        result.emplace_back(driveSNs[i], type, name, error);
     }
-    for (const auto& [_, mcu] : bplMCUs)
+    return result;
+}
+
+std::vector<std::tuple<std::string, std::string>>
+    Manager::setDriveLocationLEDs(
+        std::vector<std::tuple<std::string, bool>> requests)
+{
+    std::vector<std::string> driveSNs;
+    for (const auto& [driveSN, assert] : requests)
+    {
+        driveSNs.push_back(driveSN);
+    }
+    auto locations = lookupDrives(driveSNs);
+
+    // group the requests by backplanes to send a single command to each MCU
+    std::map<std::shared_ptr<BackplaneController>,
+             std::pair<std::vector<size_t>,
+                       std::vector<std::pair<std::string, bool>>>>
+        batches;
+    for (size_t i = 0; i < requests.size(); ++i)
     {
-        auto chanName = mcu->findChannelByDriveSN(driveSN);
-        if (!chanName.empty())
+        const auto& [mcu, chanName] = locations[i].first;
+        if (mcu)
         {
-            mcu->setDriveLocationLED(chanName, assert);
-            return;
+            auto& [indexes, leds] = batches[mcu];
+            indexes.push_back(i);
+            leds.emplace_back(chanName, std::get<bool>(requests[i]));
+        }
+    }
+    for (const auto& [mcu, batch] : batches)
+    {
+        const auto& [indexes, leds] = batch;
+        try
+        {
+            mcu->setDriveLocationLEDs(leds);
+        }
+        catch (const sdbusplus::exception::exception& e)
+        {
+            for (const auto i : indexes)
+            {
+                locations[i].second = e.name();
+            }
+        }
+        catch (const std::exception& e)
+        {
+            log<level::ERR>("Failed to set location LEDs",
+                            entry("ERROR=%s", e.what()));
+            for (const auto i : indexes)
+            {
+                locations[i].second = InternalFailure().name();
+            }
         }
     }
-    throw ResourceNotFound();
+
+    std::vector<std::tuple<std::string, std::string>> result;
+    for (size_t i = 0; i < driveSNs.size(); ++i)
+    {
+        result.emplace_back(driveSNs[i], locations[i].second);
+    }
+    return result;
 }
 
-bool Manager::getDriveLocationLED(std::string driveSN)
+std::vector<std::tuple<std::string, bool, std::string>>
+    Manager::getDriveLocationLEDs(std::vector<std::string> driveSNs)
 {
-    if (driveSN.empty())
+    auto locations = lookupDrives(driveSNs);
+    std::vector<bool> states(driveSNs.size(), false);
+
+    // group the requests by backplanes to send a single command to each MCU
+    std::map<std::shared_ptr<BackplaneController>,
+             std::pair<std::vector<size_t>, std::vector<std::string>>>
+        batches;
+    for (size_t i = 0; i < driveSNs.size(); ++i)
     {
-        throw InvalidArgument();
+        const auto& [mcu, chanName] = locations[i].first;
+        if (mcu)
+        {
+            auto& [indexes, chanNames] = batches[mcu];
+            indexes.push_back(i);
+            chanNames.push_back(chanName);
+        }
     }
-    for (const auto& [_, mcu] : bplMCUs)
+    for (const auto& [mcu, batch] : batches)
     {
-        auto chanName = mcu->findChannelByDriveSN(driveSN);
-        if (!chanName.empty())
+        const auto& [indexes, chanNames] = batch;
+        try
+        {
+            const auto leds = mcu->getDriveLocationLEDs(chanNames);
+            for (size_t j = 0; j < indexes.size(); ++j)
+            {
+                states[indexes[j]] = leds[j];
+            }
+        }
+        catch (const sdbusplus::exception::exception& e)
         {
-            return mcu->getDriveLocationLED(chanName);
+            for (const auto i : indexes)
+            {
+                locations[i].second = e.name();
+            }
+        }
+        catch (const std::exception& e)
+        {
+            log<level::ERR>("Failed to get location LEDs",
+                            entry("ERROR=%s", e.what()));
+            for (const auto i : indexes)
+            {
+                locations[i].second = InternalFailure().name();
+            }
         }
     }
-    throw ResourceNotFound();
-    return false;
+
+    std::vector<std::tuple<std::string, bool, std::string>> result;
+    for (size_t i = 0; i < driveSNs.size(); ++i)
+    {
+        result.emplace_back(driveSNs[i], states[i], locations[i].second);
+    }
+    return result;
+}
+
+/**
+ * @brief Find backplane controller serving the slot
+ *
+ * @return backplane controller
+ */
+std::shared_ptr<BackplaneController>
+    Manager::lookupSlot(const std::string& backplane, const std::string& slot)
+{
+    auto it = bplMCUs.find(backplane);
+    if (it == bplMCUs.end() || !it->second->hasChannel(slot))
+    {
+        throw ResourceNotFound();
+    }
+    return it->second;
+}
+
+void Manager::setSlotLocationLED(std::string backplane, std::string slot,
+                                 bool assert)
+{
+    lookupSlot(backplane, slot)->setDriveLocationLED(slot, assert);
+}
+
+bool Manager::getSlotLocationLED(std::string backplane, std::string slot)
+{
+    return lookupSlot(backplane, slot)->getDriveLocationLED(slot);
+}
+
+std::tuple<std::string, std::string, bool>
+    Manager::getSlotStatus(std::string backplane, std::string slot)
+{
+    const auto [driveIface, sn, failure] =
+        lookupSlot(backplane, slot)->getSlotStatus(slot);
+    return std::make_tuple(
+        sdbusplus::message::details::convert_to_string(driveIface), sn,
+        failure);
 }
 
 void Manager::resetDriveLocationLEDs()
@@ -494,8 +1456,19 @@ static void showUsage(char* appName)
 {
     fprintf(stderr, R"(Usage: %s [options]
 Options:
-  -v, --verbose  Enable output debug messages.
-  -h, --help     Show this help
+  -v, --verbose        Enable output debug messages.
+  -n, --no-sn-verify   Don't verify the indexed slot on drive lookups.
+                       Indexed drives are found without I2C access then,
+                       but a drive swapped since the last refresh is not
+                       detected.
+  -p, --health-period SEC
+                       Poll NVMe drives health every SEC seconds using
+                       NVMe-MI Basic Management Command (disabled by default).
+  -r, --health-rate N  Poll no more than N drives per second (default 4).
+  -s, --no-drives-signal
+                       Don't signal changes of the aggregate Drives property,
+                       use the per-slot objects instead.
+  -h, --help           Show this help
 )",
             appName);
 }
@@ -509,16 +1482,38 @@ int main(int argc, char** argv)
 {
     const struct option opts[] = {
         {"verbose", no_argument, nullptr, 'v'},
+        {"no-sn-verify", no_argument, nullptr, 'n'},
+        {"health-period", required_argument, nullptr, 'p'},
+        {"health-rate", required_argument, nullptr, 'r'},
+        {"no-drives-signal", no_argument, nullptr, 's'},
         {"help", no_argument, nullptr, 'h'},
         {nullptr, 0, nullptr, '\0'}};
     int c;
-    while ((c = getopt_long(argc, argv, "vh", opts, nullptr)) != -1)
+    while ((c = getopt_long(argc, argv, "vnp:r:sh", opts, nullptr)) != -1)
     {
         switch (c)
         {
             case 'v':
                 i2cDev::verbose = true;
                 break;
+            case 'n':
+                verifyDriveSN = false;
+                break;
+            case 'p':
+                healthPollPeriod =
+                    std::chrono::seconds(strtoul(optarg, nullptr, 0));
+                break;
+            case 'r':
+                healthPollRate = strtoul(optarg, nullptr, 0);
+                if (!healthPollRate)
+                {
+                    showUsage(argv[0]);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 's':
+                BackplaneController::drivesSignal = false;
+                break;
             case 'h':
                 showUsage(argv[0]);
                 return 0;
@@ -530,7 +1525,7 @@ int main(int argc, char** argv)
     sigset_t ss;
 
     if (sigemptyset(&ss) < 0 || sigaddset(&ss, SIGTERM) < 0 ||
-        sigaddset(&ss, SIGINT) < 0 || sigaddset(&ss, SIGCHLD) < 0)
+        sigaddset(&ss, SIGINT) < 0)
     {
         log<level::ERR>("ERROR: Failed to setup signal handlers",
                         entry("REASON=%s", strerror(errno)));
@@ -554,9 +1549,15 @@ int main(int argc, char** argv)
     sdbusplus::server::manager_t objManager(bus, "/");
 
     Manager storageManager(bus, event);
-    storageManager.rescan();
+    storageManager.loadDrives();
+    // outdated MCUs are reflashed in the background, so they are queued
+    // before the controllers are created
+    storageManager.reflash();
+    // the last known state is published at once, so the name is requested
+    // before the configuration is read and MCUs are probed
+    storageManager.restoreState();
+    bus.request_name(dbus::stormgr::busName);
     storageManager.applyConfiguration();
 
-    bus.request_name(dbus::stormgr::busName);
     return event.loop();
 }
@@ -0,0 +1,110 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (C) 2022, KNS Group LLC (YADRO)
+ */
+
+#include "nvme_mi.hpp"
+
+#include "common_i2c.hpp"
+
+#include <phosphor-logging/log.hpp>
+
+#include <cstring>
+
+using namespace phosphor::logging;
+
+static constexpr int nvmeMIBasicAddr = 0x6A;
+/* Command code of the drive status data structure */
+static constexpr uint8_t cmdDriveStatus = 0x00;
+
+/* Drive status data structure: length, status flags, SMART warnings,
+ * composite temperature, drive life used, 2 reserved bytes and PEC */
+static constexpr size_t statusSize = 8;
+static constexpr size_t statusLengthByte = 0;
+static constexpr size_t statusFlagsByte = 1;
+static constexpr size_t statusWarningsByte = 2;
+static constexpr size_t statusTempByte = 3;
+static constexpr size_t statusLifeUsedByte = 4;
+static constexpr size_t statusPECByte = 7;
+static constexpr uint8_t statusLength = 6;
+
+/* Status flags bits */
+static constexpr uint8_t flagDriveNotReady = 1 << 6;
+static constexpr uint8_t flagDriveFunctional = 1 << 5;
+/* SMART warnings bits defined by the specification */
+static constexpr uint8_t warningsMask = 0x3F;
+
+/* Composite temperature special values */
+static constexpr uint8_t tempMax = 0x7F;
+static constexpr uint8_t tempMin = 0xC4;
+
+/**
+ * @brief Calculate SMBus packet error code (CRC-8, x^8 + x^2 + x + 1)
+ */
+static uint8_t smbusPEC(uint8_t crc, const uint8_t* data, size_t len)
+{
+    for (size_t i = 0; i < len; ++i)
+    {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; ++bit)
+        {
+            crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+std::optional<NVMeHealth> readNVMeHealth(const std::string& devPath)
+{
+    if (devPath.empty())
+    {
+        return std::nullopt;
+    }
+    i2cDev dev(devPath, nvmeMIBasicAddr);
+    if (!dev.isOk())
+    {
+        return std::nullopt;
+    }
+
+    uint8_t buf[statusSize] = {0};
+    int res = dev.read_i2c_blob(cmdDriveStatus, sizeof(buf), buf);
+    if (res < 0)
+    {
+        return std::nullopt;
+    }
+
+    // PEC covers the whole SMBus block read transaction including addresses
+    const uint8_t header[] = {nvmeMIBasicAddr << 1, cmdDriveStatus,
+                              (nvmeMIBasicAddr << 1) | 1};
+    uint8_t pec = smbusPEC(0, header, sizeof(header));
+    pec = smbusPEC(pec, buf, statusPECByte);
+    if (pec != buf[statusPECByte] || buf[statusLengthByte] != statusLength)
+    {
+        log<level::ERR>("Invalid NVMe-MI drive status data",
+                        entry("BUS=%s", devPath.c_str()),
+                        entry("LENGTH=%d", buf[statusLengthByte]),
+                        entry("PEC=0x%02x", buf[statusPECByte]),
+                        entry("EXPECTED_PEC=0x%02x", pec));
+        return std::nullopt;
+    }
+
+    NVMeHealth health;
+    const uint8_t flags = buf[statusFlagsByte];
+    health.ready = !(flags & flagDriveNotReady);
+    health.functional = flags & flagDriveFunctional;
+    // SMART warnings bits are cleared when the warning is active
+    health.criticalWarning = ~buf[statusWarningsByte] & warningsMask;
+    health.lifeUsed = buf[statusLifeUsedByte];
+
+    const uint8_t temp = buf[statusTempByte];
+    if (temp <= tempMax)
+    {
+        health.temperature = temp;
+    }
+    else if (temp >= tempMin)
+    {
+        health.temperature = static_cast<int8_t>(temp);
+    }
+    // the rest values mean no data, sensor failure or reserved
+    return health;
+}
@@ -0,0 +1,38 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (C) 2022, KNS Group LLC (YADRO)
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+
+/**
+ * @brief Drive health reported by NVMe-MI Basic Management Command
+ */
+struct NVMeHealth
+{
+    /** @brief Composite temperature in degrees Celsius, empty if the drive
+     *         doesn't report it */
+    std::optional<int> temperature;
+    /** @brief Critical warning bits, a bit is set if the warning is active
+     *         (the inverted SMART Warnings field) */
+    uint8_t criticalWarning;
+    /** @brief Percentage of the drive life used, 255 means 255% or more */
+    uint8_t lifeUsed;
+    /** @brief Drive is ready to process NVMe-MI commands */
+    bool ready;
+    /** @brief Drive is functional */
+    bool functional;
+};
+
+/**
+ * @brief Read drive health using NVMe-MI Basic Management Command
+ *
+ * @param[in] devPath - drive I2C bus device file path
+ * @return health data or empty if the drive doesn't respond or the packet
+ *         error code is invalid
+ */
+std::optional<NVMeHealth> readNVMeHealth(const std::string& devPath);
@@ -0,0 +1,406 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (C) 2022, KNS Group LLC (YADRO)
+ */
+
+#include "nvme_vpd.hpp"
+
+#include "common.hpp"
+#include "common_i2c.hpp"
+
+#include <phosphor-logging/log.hpp>
+
+#include <algorithm>
+#include <array>
+#include <bitset>
+#include <cstring>
+#include <vector>
+
+using namespace phosphor::logging;
+
+static constexpr int nvmeVPDAddr = 0x53;
+/* NVMe-MI VPD EEPROM size */
+static constexpr size_t vpdSize = 256;
+/* Max number of bytes read in a single I2C transaction */
+static constexpr size_t maxReadSize = 255;
+
+// FRU areas are measured in 8-byte blocks
+static constexpr size_t fruBlockSize = 8;
+static constexpr size_t fruHeaderSize = 8;
+static constexpr size_t fruAreaBoardByte = 3;
+static constexpr size_t fruAreaProductByte = 4;
+static constexpr size_t fruAreaMultiRecordByte = 5;
+static constexpr uint8_t fruEndOfFields = 0xC1;
+
+/* Offset of the first field in the board info area (after version, length,
+ * language code and manufacturing date) */
+static constexpr size_t fruBoardFieldsOffset = 6;
+/* Offset of the first field in the product info area (after version, length
+ * and language code) */
+static constexpr size_t fruProductFieldsOffset = 3;
+
+enum FRUBoardField
+{
+    boardManufacturer = 0,
+    boardProductName,
+    boardSerialNumber,
+    boardPartNumber,
+};
+
+enum FRUProductField
+{
+    productManufacturer = 0,
+    productName,
+    productPartNumber,
+    productVersion,
+    productSerialNumber,
+};
+
+enum FRUDataEncoding
+{
+    binary = 0x0,
+    bcdPlus = 0x1,
+    sixBitASCII = 0x2,
+    languageDependent = 0x3,
+};
+
+constexpr size_t v1aSNFieldOffset = 5;
+constexpr size_t v1aSNFieldSize = 20;
+
+/**
+ * @brief VPD EEPROM image, tracks the bytes read already to avoid reading them
+ *        again
+ */
+class VPDImage
+{
+  public:
+    VPDImage(i2cDev& dev) : dev(dev)
+    {}
+
+    /**
+     * @brief Make sure the range is read from the device
+     *
+     * The missing bytes of the range are read with the minimum number of
+     * transactions.
+     *
+     * @param[in] offset - offset of the range
+     * @param[in] size - size of the range
+     * @return false on I2C failure
+     */
+    bool load(size_t offset, size_t size)
+    {
+        size_t end = std::min(offset + size, vpdSize);
+        while (offset < end && loaded[offset])
+        {
+            ++offset;
+        }
+        while (end > offset && loaded[end - 1])
+        {
+            --end;
+        }
+        while (offset < end)
+        {
+            const size_t readBytes = std::min(end - offset, maxReadSize);
+            int res = dev.read_i2c_blob(offset, readBytes, buf.data() + offset);
+            if (res < 0)
+            {
+                log<level::ERR>("Failed to read drive VPD area",
+                                entry("OFFSET=%zu", offset),
+                                entry("RESULT=%d", res),
+                                entry("REASON=%s", std::strerror(-res)));
+                return false;
+            }
+            for (size_t i = offset; i < offset + readBytes; ++i)
+            {
+                loaded.set(i);
+            }
+            bytesRead += readBytes;
+            offset += readBytes;
+        }
+        return true;
+    }
+
+    const uint8_t* data() const
+    {
+        return buf.data();
+    }
+
+    size_t bytesRead = 0;
+
+  private:
+    i2cDev& dev;
+    std::array<uint8_t, vpdSize> buf{};
+    std::bitset<vpdSize> loaded;
+};
+
+static bool fruValidateHeader(const uint8_t* blockData)
+{
+    // ipmi spec format version number is currently at 1, verify it
+    if (blockData[0] != 0x1)
+    {
+        return false;
+    }
+
+    // verify pad is set to 0
+    if (blockData[6] != 0x0)
+    {
+        return false;
+    }
+
+    // validate checksum
+    size_t sum = 0;
+    for (size_t jj = 0; jj < fruHeaderSize; jj++)
+    {
+        sum += blockData[jj];
+    }
+    sum = (256 - sum) & 0xFF;
+
+    if (sum)
+    {
+        return false;
+    }
+    return true;
+}
+
+// Calculate new checksum for fru info area
+static uint8_t fruCalculateChecksum(const uint8_t* data, size_t len)
+{
+    constexpr int checksumMod = 256;
+    constexpr uint8_t modVal = 0xFF;
+    int sum = 0;
+    for (size_t index = 0; index < len; index++)
+    {
+        sum += data[index];
+    }
+    int checksum = (checksumMod - sum) & modVal;
+    return static_cast<uint8_t>(checksum);
+}
+
+/**
+ * @brief Decode FRU field data according to its type/length byte
+ */
+static std::string fruDecodeField(uint8_t typeLength, const uint8_t* data)
+{
+    const size_t len = typeLength & 0x3F;
+    std::string value;
+    switch ((typeLength >> 6) & 0x03)
+    {
+        case FRUDataEncoding::binary:
+            for (size_t i = 0; i < len; ++i)
+            {
+                static constexpr const char* hex = "0123456789ABCDEF";
+                value += hex[data[i] >> 4];
+                value += hex[data[i] & 0x0F];
+            }
+            break;
+        case FRUDataEncoding::bcdPlus:
+            for (size_t i = 0; i < len * 2; ++i)
+            {
+                static constexpr const char* bcdPlusChars = "0123456789 -.???";
+                const uint8_t digit =
+                    (i % 2) ? (data[i / 2] & 0x0F) : (data[i / 2] >> 4);
+                value += bcdPlusChars[digit];
+            }
+            break;
+        case FRUDataEncoding::sixBitASCII:
+            // every 3 bytes hold 4 characters, LSB first
+            for (size_t bit = 0; bit + 6 <= len * 8; bit += 6)
+            {
+                const size_t byte = bit / 8;
+                unsigned bits = data[byte];
+                if (byte + 1 < len)
+                {
+                    bits |= data[byte + 1] << 8;
+                }
+                value += static_cast<char>(0x20 + ((bits >> (bit % 8)) & 0x3F));
+            }
+            break;
+        case FRUDataEncoding::languageDependent:
+            // english language is assumed, so it is 8-bit ASCII
+            value.assign(reinterpret_cast<const char*>(data), len);
+            break;
+    }
+    rtrim(value);
+    return value;
+}
+
+/**
+ * @brief Parse FRU info area (board or product) and decode its fields
+ *
+ * @param[in] area - pointer to the area data
+ * @param[in] maxSize - max area size, bytes beyond are not read
+ * @param[in] fieldsOffset - offset of the first variable length field
+ * @return list of decoded fields, empty on failure
+ */
+static std::vector<std::string> fruParseArea(const uint8_t* area,
+                                             size_t maxSize,
+                                             size_t fieldsOffset)
+{
+    std::vector<std::string> fields;
+    const size_t areaSize = area[1] * fruBlockSize;
+    if (area[0] != 0x1 || areaSize <= fieldsOffset || areaSize > maxSize)
+    {
+        log<level::ERR>("Invalid drive FRU area header",
+                        entry("SIZE=%zu", areaSize));
+        return fields;
+    }
+    if (fruCalculateChecksum(area, areaSize) != 0)
+    {
+        log<level::ERR>("Drive FRU area checksum error");
+        return fields;
+    }
+
+    size_t offset = fieldsOffset;
+    while (offset < areaSize && area[offset] != fruEndOfFields)
+    {
+        const size_t len = area[offset] & 0x3F;
+        if (offset + 1 + len > areaSize)
+        {
+            log<level::ERR>("Drive FRU area field out of bounds",
+                            entry("OFFSET=%zu", offset));
+            break;
+        }
+        fields.emplace_back(fruDecodeField(area[offset], area + offset + 1));
+        offset += 1 + len;
+    }
+    return fields;
+}
+
+static std::string getField(const std::vector<std::string>& fields,
+                            size_t index)
+{
+    return index < fields.size() ? fields[index] : std::string();
+}
+
+/**
+ * @brief Read and decode FRU formatted VPD
+ *
+ * @return false if VPD is not in FRU format or can't be read
+ */
+static bool readNVMeVPDFRU(VPDImage& image, DriveVPD& vpd)
+{
+    const uint8_t* header = image.data();
+    if (!fruValidateHeader(header))
+    {
+        return false;
+    }
+
+    // Every area is limited by the next one, the areas are not required to be
+    // placed in order, so sort the offsets
+    std::vector<size_t> offsets;
+    for (size_t i = 1; i <= fruAreaMultiRecordByte; ++i)
+    {
+        if (header[i])
+        {
+            offsets.push_back(header[i] * fruBlockSize);
+        }
+    }
+    offsets.push_back(vpdSize);
+    std::sort(offsets.begin(), offsets.end());
+    const auto areaEnd = [&offsets](size_t start) {
+        return *std::upper_bound(offsets.begin(), offsets.end(), start);
+    };
+
+    const size_t boardStart = header[fruAreaBoardByte] * fruBlockSize;
+    const size_t productStart = header[fruAreaProductByte] * fruBlockSize;
+    if (!(boardStart || productStart) || boardStart >= vpdSize ||
+        productStart >= vpdSize)
+    {
+        return false;
+    }
+
+    // Both areas are usually adjacent, so read them at once
+    size_t readStart = vpdSize;
+    size_t readEnd = 0;
+    for (const size_t start : {boardStart, productStart})
+    {
+        if (start)
+        {
+            readStart = std::min(readStart, start);
+            readEnd = std::max(readEnd, areaEnd(start));
+        }
+    }
+    if (!image.load(readStart, readEnd - readStart))
+    {
+        return false;
+    }
+
+    std::vector<std::string> board;
+    if (boardStart)
+    {
+        board = fruParseArea(image.data() + boardStart,
+                             areaEnd(boardStart) - boardStart,
+                             fruBoardFieldsOffset);
+    }
+    std::vector<std::string> product;
+    if (productStart)
+    {
+        product = fruParseArea(image.data() + productStart,
+                               areaEnd(productStart) - productStart,
+                               fruProductFieldsOffset);
+    }
+
+    // product area is preferred, board area is used as a fallback
+    vpd.manufacturer = getField(product, productManufacturer);
+    if (vpd.manufacturer.empty())
+    {
+        vpd.manufacturer = getField(board, boardManufacturer);
+    }
+    vpd.model = getField(product, productName);
+    if (vpd.model.empty())
+    {
+        vpd.model = getField(board, boardProductName);
+    }
+    vpd.partNumber = getField(product, productPartNumber);
+    if (vpd.partNumber.empty())
+    {
+        vpd.partNumber = getField(board, boardPartNumber);
+    }
+    vpd.serialNumber = getField(product, productSerialNumber);
+    if (vpd.serialNumber.empty())
+    {
+        vpd.serialNumber = getField(board, boardSerialNumber);
+    }
+    return true;
+}
+
+static bool readNVMeVPDV1A(VPDImage& image, DriveVPD& vpd)
+{
+    if (!image.load(0, v1aSNFieldOffset + v1aSNFieldSize))
+    {
+        return false;
+    }
+    const uint8_t* buf = image.data();
+    if (!((buf[0] == 0x02) && (buf[1] == 0x08) && (buf[2] == 0x01)))
+    {
+        return false;
+    }
+
+    const char* snPtr = reinterpret_cast<const char*>(buf);
+    vpd.serialNumber = std::string{snPtr + v1aSNFieldOffset, v1aSNFieldSize};
+    rtrim(vpd.serialNumber);
+    return true;
+}
+
+DriveVPD readNVMeVPD(const std::string& devPath)
+{
+    DriveVPD vpd;
+    if (devPath.empty())
+    {
+        return vpd;
+    }
+    i2cDev dev(devPath, nvmeVPDAddr);
+    if (!dev.isOk())
+    {
+        return vpd;
+    }
+
+    VPDImage image(dev);
+    if (image.load(0, fruHeaderSize) && !readNVMeVPDFRU(image, vpd))
+    {
+        vpd = DriveVPD();
+        readNVMeVPDV1A(image, vpd);
+    }
+    vpd.bytesRead = image.bytesRead;
+    return vpd;
+}
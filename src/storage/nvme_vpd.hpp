@@ -0,0 +1,33 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (C) 2022, KNS Group LLC (YADRO)
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+/**
+ * @brief Asset information read from NVMe drive VPD
+ */
+struct DriveVPD
+{
+    std::string manufacturer; //!< drive manufacturer
+    std::string model;        //!< product name
+    std::string partNumber;   //!< part (model) number
+    std::string serialNumber; //!< drive serial number
+    size_t bytesRead = 0;     //!< number of bytes read from the VPD EEPROM
+};
+
+/**
+ * @brief Read NVMe drive VPD
+ *
+ * Both IPMI FRU formatted VPD (product and board info areas are decoded) and
+ * the legacy format containing only the serial number are supported. The
+ * areas are located by the FRU header, so only the required bytes are read.
+ *
+ * @param[in] devPath - drive I2C bus device file path
+ * @return VPD data, all the fields are empty on failure
+ */
+DriveVPD readNVMeVPD(const std::string& devPath);
@@ -0,0 +1,354 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (C) 2022, KNS Group LLC (YADRO)
+ */
+
+#include "state_snapshot.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <phosphor-logging/log.hpp>
+
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+using namespace phosphor::logging;
+using DriveInterface =
+    sdbusplus::com::yadro::HWManager::server::BackplaneMCU::DriveInterface;
+
+/*
+ * Snapshot format (all integers are little-endian):
+ *   magic "YSMS", format version (u16), controllers count (u16),
+ *   controllers, checksum (u32, FNV-1a of all the preceding bytes).
+ * Controller:
+ *   name, bus (u16), address (u16), inventory path, flags (u8),
+ *   channels count (u8), channels: index (u8) and name,
+ *   firmware version, board type,
+ *   drives count (u8), drives: port, SN, interface (u8), failed (u8).
+ * Strings are stored as length (u16) followed by the characters.
+ */
+static constexpr char snapshotMagic[] = {'Y', 'S', 'M', 'S'};
+static constexpr uint16_t snapshotVersion = 1;
+
+static constexpr uint8_t flagHaveDriveI2C = 1 << 0;
+static constexpr uint8_t flagSoftwarePowerGood = 1 << 1;
+
+/**
+ * @brief Write data to the file and flush it to the storage
+ *
+ * @param[in] file - file path, the file is created or truncated
+ * @param[in] data - data to write
+ * @return 0 on success, errno value on failure
+ */
+static int writeFileSync(const std::filesystem::path& file,
+                         const std::string& data)
+{
+    const int fd =
+        open(file.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+    {
+        return errno;
+    }
+    int err = 0;
+    size_t written = 0;
+    while (written < data.size())
+    {
+        const ssize_t res =
+            write(fd, data.data() + written, data.size() - written);
+        if (res < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            err = errno;
+            break;
+        }
+        written += res;
+    }
+    if (!err && fsync(fd) < 0)
+    {
+        err = errno;
+    }
+    if (close(fd) < 0 && !err)
+    {
+        err = errno;
+    }
+    return err;
+}
+
+/**
+ * @brief Flush the directory entries to the storage
+ *
+ * @param[in] dir - directory path
+ * @return 0 on success, errno value on failure
+ */
+static int syncDir(const std::filesystem::path& dir)
+{
+    const int fd = open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return errno;
+    }
+    int err = 0;
+    if (fsync(fd) < 0)
+    {
+        err = errno;
+    }
+    close(fd);
+    return err;
+}
+
+static uint32_t fnv1a(const std::string& data)
+{
+    uint32_t hash = 2166136261U;
+    for (const char c : data)
+    {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 16777619U;
+    }
+    return hash;
+}
+
+/**
+ * @brief Snapshot serializer
+ */
+class Writer
+{
+  public:
+    template <typename T>
+    void put(T value)
+    {
+        for (size_t i = 0; i < sizeof(T); ++i)
+        {
+            data.push_back(static_cast<char>(value >> (i * 8)));
+        }
+    }
+
+    void put(const std::string& str)
+    {
+        put<uint16_t>(str.size());
+        data += str;
+    }
+
+    std::string data;
+};
+
+/**
+ * @brief Snapshot deserializer, throws std::out_of_range on truncated data
+ */
+class Reader
+{
+  public:
+    /**
+     * @param[in] data - serialized data, must outlive the reader
+     * @param[in] size - end offset of the data to decode
+     * @param[in] offset - offset of the first byte to decode
+     */
+    Reader(const std::string& data, size_t size, size_t offset = 0) :
+        data(data), size(size), offset(offset)
+    {}
+
+    template <typename T>
+    T get()
+    {
+        check(sizeof(T));
+        T value = 0;
+        for (size_t i = 0; i < sizeof(T); ++i)
+        {
+            value |= static_cast<T>(static_cast<uint8_t>(data[offset++]))
+                     << (i * 8);
+        }
+        return value;
+    }
+
+    std::string getString()
+    {
+        const size_t len = get<uint16_t>();
+        check(len);
+        std::string str = data.substr(offset, len);
+        offset += len;
+        return str;
+    }
+
+    bool end() const
+    {
+        return offset == size;
+    }
+
+  private:
+    void check(size_t len)
+    {
+        if (offset + len > size)
+        {
+            throw std::out_of_range("Snapshot is truncated");
+        }
+    }
+
+    const std::string& data;
+    size_t size;
+    size_t offset;
+};
+
+bool saveSnapshot(const std::filesystem::path& file,
+                  const std::vector<ControllerSnapshot>& controllers)
+{
+    Writer writer;
+    writer.data.assign(snapshotMagic, sizeof(snapshotMagic));
+    writer.put<uint16_t>(snapshotVersion);
+    writer.put<uint16_t>(controllers.size());
+    for (const auto& mcu : controllers)
+    {
+        writer.put(mcu.name);
+        writer.put<uint16_t>(mcu.i2cBus);
+        writer.put<uint16_t>(mcu.i2cAddr);
+        writer.put(mcu.inventory);
+        writer.put<uint8_t>(
+            (mcu.config.haveDriveI2C ? flagHaveDriveI2C : 0) |
+            (mcu.config.softwarePowerGood ? flagSoftwarePowerGood : 0));
+        writer.put<uint8_t>(mcu.config.channels.size());
+        for (const auto& [chanIndex, chanName] : mcu.config.channels)
+        {
+            writer.put<uint8_t>(chanIndex);
+            writer.put(chanName);
+        }
+        writer.put(mcu.state.version);
+        writer.put(mcu.state.boardType);
+        writer.put<uint8_t>(mcu.state.drives.size());
+        for (const auto& [chanName, sn, driveIface, failure] :
+             mcu.state.drives)
+        {
+            writer.put(chanName);
+            writer.put(sn);
+            writer.put<uint8_t>(static_cast<uint8_t>(driveIface));
+            writer.put<uint8_t>(failure);
+        }
+    }
+    writer.put<uint32_t>(fnv1a(writer.data));
+
+    std::error_code ec;
+    std::filesystem::create_directories(file.parent_path(), ec);
+    std::filesystem::path tmpFile = file;
+    tmpFile += ".tmp";
+    // the data must reach the storage before the rename, otherwise the
+    // snapshot may be empty or truncated after a power loss
+    const int err = writeFileSync(tmpFile, writer.data);
+    if (err)
+    {
+        log<level::ERR>("Failed to write state snapshot",
+                        entry("FILE=%s", tmpFile.c_str()),
+                        entry("ERROR=%s", std::strerror(err)));
+        std::filesystem::remove(tmpFile, ec);
+        return false;
+    }
+    std::filesystem::rename(tmpFile, file, ec);
+    if (ec)
+    {
+        log<level::ERR>("Failed to replace state snapshot",
+                        entry("FILE=%s", file.c_str()),
+                        entry("ERROR=%s", ec.message().c_str()));
+        std::filesystem::remove(tmpFile, ec);
+        return false;
+    }
+    // the rename is persisted with the directory
+    const int dirErr = syncDir(file.parent_path());
+    if (dirErr)
+    {
+        log<level::WARNING>("Failed to sync state snapshot directory",
+                            entry("FILE=%s", file.c_str()),
+                            entry("ERROR=%s", std::strerror(dirErr)));
+    }
+    return true;
+}
+
+std::vector<ControllerSnapshot> loadSnapshot(const std::filesystem::path& file)
+{
+    std::vector<ControllerSnapshot> controllers;
+    std::ifstream in(file, std::ios::binary);
+    if (!in.is_open())
+    {
+        return controllers;
+    }
+    const std::string data((std::istreambuf_iterator<char>(in)),
+                           std::istreambuf_iterator<char>());
+    if (data.size() < sizeof(snapshotMagic) + sizeof(uint32_t) ||
+        data.compare(0, sizeof(snapshotMagic), snapshotMagic,
+                     sizeof(snapshotMagic)) != 0)
+    {
+        log<level::ERR>("Invalid state snapshot",
+                        entry("FILE=%s", file.c_str()));
+        return controllers;
+    }
+
+    const size_t payloadSize = data.size() - sizeof(uint32_t);
+    try
+    {
+        Reader checksum(data, data.size(), payloadSize);
+        if (checksum.get<uint32_t>() != fnv1a(data.substr(0, payloadSize)))
+        {
+            throw std::runtime_error("Checksum mismatch");
+        }
+
+        Reader reader(data, payloadSize);
+        for (size_t i = 0; i < sizeof(snapshotMagic); ++i)
+        {
+            reader.get<uint8_t>();
+        }
+        if (reader.get<uint16_t>() != snapshotVersion)
+        {
+            throw std::runtime_error("Unsupported format version");
+        }
+        const size_t count = reader.get<uint16_t>();
+        for (size_t i = 0; i < count; ++i)
+        {
+            ControllerSnapshot mcu;
+            mcu.name = reader.getString();
+            mcu.i2cBus = reader.get<uint16_t>();
+            mcu.i2cAddr = reader.get<uint16_t>();
+            mcu.inventory = reader.getString();
+            const uint8_t flags = reader.get<uint8_t>();
+            mcu.config.haveDriveI2C = flags & flagHaveDriveI2C;
+            mcu.config.softwarePowerGood = flags & flagSoftwarePowerGood;
+            const size_t channels = reader.get<uint8_t>();
+            for (size_t chan = 0; chan < channels; ++chan)
+            {
+                const int chanIndex = reader.get<uint8_t>();
+                mcu.config.channels[chanIndex] = reader.getString();
+            }
+            mcu.state.version = reader.getString();
+            mcu.state.boardType = reader.getString();
+            const size_t drives = reader.get<uint8_t>();
+            for (size_t drive = 0; drive < drives; ++drive)
+            {
+                std::string chanName = reader.getString();
+                std::string sn = reader.getString();
+                const uint8_t iface = reader.get<uint8_t>();
+                if (iface > static_cast<uint8_t>(DriveInterface::NVMe))
+                {
+                    throw std::runtime_error("Invalid drive interface");
+                }
+                const auto driveIface = static_cast<DriveInterface>(iface);
+                const bool failure = reader.get<uint8_t>();
+                mcu.state.drives.emplace_back(std::move(chanName),
+                                              std::move(sn), driveIface,
+                                              failure);
+            }
+            controllers.push_back(std::move(mcu));
+        }
+        if (!reader.end())
+        {
+            throw std::runtime_error("Unexpected trailing data");
+        }
+    }
+    catch (const std::exception& e)
+    {
+        log<level::ERR>("Invalid state snapshot",
+                        entry("FILE=%s", file.c_str()),
+                        entry("REASON=%s", e.what()));
+        controllers.clear();
+    }
+    return controllers;
+}
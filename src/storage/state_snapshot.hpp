@@ -0,0 +1,45 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (C) 2022, KNS Group LLC (YADRO)
+ */
+
+#pragma once
+
+#include "backplane_control.hpp"
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Backplane controller entry of the state snapshot
+ */
+struct ControllerSnapshot
+{
+    std::string name;                 //!< controller name
+    int i2cBus;                       //!< MCU I2C bus number
+    int i2cAddr;                      //!< MCU I2C address
+    std::string inventory;            //!< inventory object path
+    BackplaneControllerConfig config; //!< controller configuration
+    BackplaneController::State state; //!< last known state
+};
+
+/**
+ * @brief Write the snapshot of backplane controllers state
+ *
+ * The file is replaced atomically, so it is never left partially written.
+ *
+ * @param[in] file - snapshot file path
+ * @param[in] controllers - controllers state
+ * @return false on failure
+ */
+bool saveSnapshot(const std::filesystem::path& file,
+                  const std::vector<ControllerSnapshot>& controllers);
+
+/**
+ * @brief Read the snapshot of backplane controllers state
+ *
+ * @param[in] file - snapshot file path
+ * @return controllers state, empty if the file is absent or invalid
+ */
+std::vector<ControllerSnapshot> loadSnapshot(const std::filesystem::path& file);
@@ -0,0 +1,250 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (C) 2022, KNS Group LLC (YADRO)
+ */
+
+#include "update_scheduler.hpp"
+
+#include <phosphor-logging/log.hpp>
+
+#include <algorithm>
+
+using namespace phosphor::logging;
+
+/* Conservative estimations used until the first update completed */
+static constexpr double defaultBytesPerSecond = 1024;
+static constexpr std::chrono::milliseconds defaultRebootTime(5000);
+/* Image size assumed if the file size can't be read */
+static constexpr size_t defaultImageSize = 128 * 1024;
+
+bool UpdateScheduler::submit(Request request)
+{
+    const std::string bus = request.devPath;
+    auto& queue = queues[bus];
+
+    const auto it = std::find_if(
+        queue.jobs.begin(), queue.jobs.end(), [&request](const Job& job) {
+            return job.request.addr == request.addr;
+        });
+    if (it != queue.jobs.end())
+    {
+        log<level::ERR>("MCU firmware update is already queued",
+                        entry("BUS=%s", bus.c_str()),
+                        entry("ADDR=%d", request.addr));
+        return false;
+    }
+
+    std::error_code ec;
+    size_t imageSize = std::filesystem::file_size(request.imagePath, ec);
+    if (ec)
+    {
+        imageSize = defaultImageSize;
+    }
+
+    queue.jobs.push_back({std::move(request), imageSize});
+    if (!queue.worker)
+    {
+        if (!start(bus))
+        {
+            queue.jobs.pop_front();
+            return false;
+        }
+    }
+    else
+    {
+        log<level::INFO>("MCU firmware update queued",
+                         entry("BUS=%s", bus.c_str()),
+                         entry("ADDR=%d", queue.jobs.back().request.addr),
+                         entry("POSITION=%zu", queue.jobs.size() - 1));
+    }
+    publish(bus);
+    return true;
+}
+
+void UpdateScheduler::cancel(const std::string& devPath, int addr)
+{
+    auto queue = queues.find(devPath);
+    if (queue == queues.end())
+    {
+        return;
+    }
+    auto& jobs = queue->second.jobs;
+    auto it = std::find_if(jobs.begin(), jobs.end(), [addr](const Job& job) {
+        return job.request.addr == addr;
+    });
+    if (it == jobs.end())
+    {
+        return;
+    }
+
+    if (it == jobs.begin() && queue->second.worker)
+    {
+        queue->second.worker->cancel();
+        return;
+    }
+
+    auto onComplete = std::move(it->request.onComplete);
+    jobs.erase(it);
+    publish(devPath);
+    onComplete(false);
+}
+
+void UpdateScheduler::remove(const std::string& devPath, int addr)
+{
+    auto queue = queues.find(devPath);
+    if (queue == queues.end())
+    {
+        return;
+    }
+    auto& jobs = queue->second.jobs;
+    auto it = std::find_if(jobs.begin(), jobs.end(), [addr](const Job& job) {
+        return job.request.addr == addr;
+    });
+    if (it == jobs.end())
+    {
+        return;
+    }
+
+    if (it == jobs.begin() && queue->second.worker)
+    {
+        queue->second.worker.reset();
+        jobs.pop_front();
+        startNext(devPath);
+        return;
+    }
+
+    jobs.erase(it);
+    publish(devPath);
+}
+
+bool UpdateScheduler::isActive(const std::string& devPath, int addr) const
+{
+    auto queue = queues.find(devPath);
+    return queue != queues.end() && queue->second.worker &&
+           queue->second.jobs.front().request.addr == addr;
+}
+
+bool UpdateScheduler::start(const std::string& bus)
+{
+    auto& queue = queues[bus];
+    auto& job = queue.jobs.front();
+    try
+    {
+        queue.worker = std::make_unique<UpdateWorker>(
+            event, job.request.devPath, job.request.addr,
+            loadImage(job.request.imagePath), job.request.imageVersion,
+            job.request.mode,
+            [this, bus](uint8_t progress) { jobProgress(bus, progress); },
+            [this, bus](bool success) { jobComplete(bus, success); });
+    }
+    catch (const std::exception& e)
+    {
+        log<level::ERR>("Failed to start MCU firmware update",
+                        entry("BUS=%s", bus.c_str()),
+                        entry("ADDR=%d", job.request.addr),
+                        entry("REASON=%s", e.what()));
+        return false;
+    }
+
+    log<level::INFO>("MCU firmware update started",
+                     entry("BUS=%s", bus.c_str()),
+                     entry("ADDR=%d", job.request.addr),
+                     entry("IMAGE=%s", job.request.imagePath.c_str()));
+    return true;
+}
+
+void UpdateScheduler::startNext(const std::string& bus)
+{
+    auto& queue = queues[bus];
+    auto& jobs = queue.jobs;
+    // completion handlers may submit a new request, which starts immediately
+    while (!queue.worker && !jobs.empty() && !start(bus))
+    {
+        auto onComplete = std::move(jobs.front().request.onComplete);
+        jobs.pop_front();
+        onComplete(false);
+    }
+    publish(bus);
+}
+
+void UpdateScheduler::jobProgress(std::string bus, uint8_t progress)
+{
+    auto& job = queues[bus].jobs.front();
+    job.progress = progress;
+    if (job.request.onProgress)
+    {
+        job.request.onProgress(progress);
+    }
+    publish(bus);
+}
+
+void UpdateScheduler::jobComplete(std::string bus, bool success)
+{
+    auto& queue = queues[bus];
+    // NOTE: the worker owns the handler being executed, so it must be kept
+    //       alive until this function returns
+    auto worker = std::move(queue.worker);
+    Job job = std::move(queue.jobs.front());
+    queue.jobs.pop_front();
+
+    if (success && worker->writeTime().count() > 0)
+    {
+        const double measured = job.imageSize * 1000.0 /
+                                worker->writeTime().count();
+        bytesPerSecond = bytesPerSecond > 0
+                             ? (bytesPerSecond + measured) / 2
+                             : measured;
+        rebootTime = rebootTime.count() > 0
+                         ? (rebootTime + worker->rebootTime()) / 2
+                         : worker->rebootTime();
+    }
+
+    if (job.request.onQueue)
+    {
+        job.request.onQueue(0, std::chrono::seconds(0));
+    }
+    job.request.onComplete(success);
+
+    startNext(bus);
+}
+
+void UpdateScheduler::publish(const std::string& bus)
+{
+    using namespace std::chrono;
+    const auto& queue = queues[bus];
+    uint32_t position = 0;
+    milliseconds timeLeft(0);
+    for (const auto& job : queue.jobs)
+    {
+        timeLeft += estimate(job);
+        if (job.request.onQueue)
+        {
+            job.request.onQueue(position,
+                                duration_cast<seconds>(timeLeft + 999ms));
+        }
+        ++position;
+    }
+}
+
+std::chrono::milliseconds UpdateScheduler::estimate(const Job& job) const
+{
+    using namespace std::chrono;
+    const double speed =
+        bytesPerSecond > 0 ? bytesPerSecond : defaultBytesPerSecond;
+    const size_t bytesLeft = job.imageSize * (100 - job.progress) / 100;
+    return milliseconds(static_cast<milliseconds::rep>(bytesLeft * 1000 /
+                                                       speed)) +
+           (rebootTime.count() > 0 ? rebootTime : defaultRebootTime);
+}
+
+std::shared_ptr<const FirmwareImage>
+    UpdateScheduler::loadImage(const std::filesystem::path& path)
+{
+    auto image = images[path].lock();
+    if (!image)
+    {
+        image = FirmwareImage::open(path);
+        images[path] = image;
+    }
+    return image;
+}
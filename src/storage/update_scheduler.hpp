@@ -0,0 +1,130 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (C) 2022, KNS Group LLC (YADRO)
+ */
+
+#pragma once
+
+#include "update_worker.hpp"
+
+#include <sdeventplus/event.hpp>
+
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <string>
+
+/**
+ * @class UpdateScheduler
+ *
+ * This class queues backplane MCU firmware updates. Updates of the MCUs on the
+ * same I2C bus are performed one by one, different buses are updated
+ * simultaneously. Queue position and estimated time are reported for every
+ * queued update, the estimation is based on the measured write throughput and
+ * MCU reboot time.
+ */
+class UpdateScheduler
+{
+  public:
+    /** @brief Queue state handler, receives queue position and time left */
+    using QueueHandler = std::function<void(uint32_t, std::chrono::seconds)>;
+
+    /**
+     * @brief Firmware update request
+     */
+    struct Request
+    {
+        std::string devPath;             //!< I2C bus device file path
+        int addr;                        //!< MCU I2C address
+        std::filesystem::path imagePath; //!< firmware image file path
+        std::string imageVersion;        //!< version of the new firmware
+        UpdateWorker::Mode mode = UpdateWorker::Mode::Update;
+        UpdateWorker::ProgressHandler onProgress;
+        UpdateWorker::CompletionHandler onComplete;
+        QueueHandler onQueue;
+    };
+
+    UpdateScheduler(const UpdateScheduler&) = delete;
+    UpdateScheduler& operator=(const UpdateScheduler&) = delete;
+    UpdateScheduler(UpdateScheduler&&) = delete;
+    UpdateScheduler& operator=(UpdateScheduler&&) = delete;
+
+    UpdateScheduler(const sdeventplus::Event& event) : event(event)
+    {}
+
+    /**
+     * @brief Queue firmware update
+     *
+     * @param[in] request - update request
+     * @return false if the same MCU is already queued or the update can't be
+     *         started, the handlers are not called in this case
+     */
+    bool submit(Request request);
+
+    /**
+     * @brief Cancel the update of specified MCU
+     *
+     * The queued update is dropped immediately, the running one is
+     * interrupted. The completion handler is called in both cases.
+     *
+     * @param[in] devPath - I2C bus device file path
+     * @param[in] addr - MCU I2C address
+     */
+    void cancel(const std::string& devPath, int addr);
+
+    /**
+     * @brief Drop the update of specified MCU without notifications
+     *
+     * The running update is cancelled and waited for.
+     *
+     * @param[in] devPath - I2C bus device file path
+     * @param[in] addr - MCU I2C address
+     */
+    void remove(const std::string& devPath, int addr);
+
+    /**
+     * @brief Check if specified MCU is being updated right now
+     *
+     * @param[in] devPath - I2C bus device file path
+     * @param[in] addr - MCU I2C address
+     */
+    bool isActive(const std::string& devPath, int addr) const;
+
+  private:
+    struct Job
+    {
+        Request request;
+        size_t imageSize;
+        uint8_t progress = 0;
+    };
+
+    /**
+     * @brief Per bus queue, the front job is running if worker is set
+     */
+    struct BusQueue
+    {
+        std::list<Job> jobs;
+        std::unique_ptr<UpdateWorker> worker;
+    };
+
+    bool start(const std::string& bus);
+    void startNext(const std::string& bus);
+    void jobProgress(std::string bus, uint8_t progress);
+    void jobComplete(std::string bus, bool success);
+    void publish(const std::string& bus);
+    std::chrono::milliseconds estimate(const Job& job) const;
+    std::shared_ptr<const FirmwareImage>
+        loadImage(const std::filesystem::path& path);
+
+    const sdeventplus::Event& event;
+    std::map<std::string, BusQueue> queues;
+    /* Images shared by the running updates */
+    std::map<std::filesystem::path, std::weak_ptr<const FirmwareImage>> images;
+
+    /* Measured values, zero until the first update completed */
+    double bytesPerSecond = 0;
+    std::chrono::milliseconds rebootTime{0};
+};
@@ -0,0 +1,190 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (C) 2022, KNS Group LLC (YADRO)
+ */
+
+#include "update_worker.hpp"
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <phosphor-logging/log.hpp>
+
+#include <algorithm>
+#include <cstring>
+
+using namespace phosphor::logging;
+
+UpdateWorker::UpdateWorker(const sdeventplus::Event& event,
+                           std::string devPath, int addr,
+                           std::shared_ptr<const FirmwareImage> image,
+                           std::string imageVersion, Mode mode,
+                           ProgressHandler onProgress,
+                           CompletionHandler onComplete) :
+    devPath(std::move(devPath)),
+    addr(addr), image(std::move(image)),
+    imageVersion(std::move(imageVersion)), mode(mode),
+    onProgress(std::move(onProgress)), onComplete(std::move(onComplete))
+{
+    eventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (eventFd < 0)
+    {
+        throw std::runtime_error(std::string("Failed to create eventfd: ") +
+                                 std::strerror(errno));
+    }
+    eventSource.emplace(event, eventFd, EPOLLIN,
+                        [this](sdeventplus::source::IO&, int, uint32_t) {
+                            dispatch();
+                        });
+    thread = std::thread(&UpdateWorker::run, this);
+}
+
+UpdateWorker::~UpdateWorker()
+{
+    cancel();
+    if (thread.joinable())
+    {
+        thread.join();
+    }
+    eventSource.reset();
+    close(eventFd);
+}
+
+void UpdateWorker::cancel()
+{
+    std::lock_guard<std::mutex> lock(engineMutex);
+    cancelled = true;
+    if (engine)
+    {
+        engine->cancel();
+    }
+}
+
+/**
+ * @brief Check if the image has to be written in the current mode
+ */
+bool UpdateWorker::flashRequired(const MCUUpdateEngine& mcu) const
+{
+    if (mode == Mode::Update || imageVersion.empty() ||
+        mcu.fwVersion() != imageVersion)
+    {
+        return true;
+    }
+    log<level::INFO>("MCU firmware is up to date, reflash skipped",
+                     entry("BUS=%s", devPath.c_str()), entry("ADDR=%d", addr),
+                     entry("VERSION=%s", imageVersion.c_str()));
+    return false;
+}
+
+void UpdateWorker::run()
+{
+    try
+    {
+        std::unique_ptr<MCUUpdateEngine> mcu;
+        try
+        {
+            mcu = std::make_unique<MCUUpdateEngine>(devPath, addr, &cancelled);
+        }
+        catch (const UpdateCancelled&)
+        {
+            throw;
+        }
+        catch (const std::exception&)
+        {
+            if (mode != Mode::ReflashIfPresent)
+            {
+                throw;
+            }
+        }
+        if (!mcu || !flashRequired(*mcu))
+        {
+            // nothing to do, the absent MCU is not an error in this mode
+            succeeded = true;
+            finished = true;
+            notify();
+            return;
+        }
+        mcu->setProgressHandler([this](size_t written, size_t total) {
+            // the last percent is reported when the new firmware is verified
+            const uint8_t value = std::min<size_t>(written * 100 / total, 99);
+            if (progress.exchange(value) != value)
+            {
+                notify();
+            }
+        });
+        {
+            std::lock_guard<std::mutex> lock(engineMutex);
+            engine = std::move(mcu);
+            if (cancelled)
+            {
+                engine->cancel();
+            }
+        }
+
+        engine->flash(*image, imageVersion);
+
+        log<level::INFO>("MCU firmware updated",
+                         entry("BUS=%s", devPath.c_str()),
+                         entry("ADDR=%d", addr),
+                         entry("VERSION=%s", engine->fwVersion().c_str()),
+                         entry("REBOOT_TIME_MS=%lld",
+                               static_cast<long long>(
+                                   engine->rebootTime().count())));
+        writeDuration = engine->writeTime();
+        rebootDuration = engine->rebootTime();
+        progress = 100;
+        succeeded = true;
+    }
+    catch (const std::exception& e)
+    {
+        log<level::ERR>("MCU firmware update failed",
+                        entry("BUS=%s", devPath.c_str()),
+                        entry("ADDR=%d", addr),
+                        entry("IMAGE=%s", image->path().c_str()),
+                        entry("REASON=%s", e.what()));
+    }
+    finished = true;
+    notify();
+}
+
+void UpdateWorker::notify()
+{
+    const uint64_t value = 1;
+    if (write(eventFd, &value, sizeof(value)) < 0)
+    {
+        log<level::ERR>("Failed to notify main loop",
+                        entry("BUS=%s", devPath.c_str()),
+                        entry("ADDR=%d", addr),
+                        entry("REASON=%s", std::strerror(errno)));
+    }
+}
+
+void UpdateWorker::dispatch()
+{
+    uint64_t value;
+    if (read(eventFd, &value, sizeof(value)) < 0 && errno != EAGAIN)
+    {
+        log<level::ERR>("Failed to read worker notification",
+                        entry("BUS=%s", devPath.c_str()),
+                        entry("ADDR=%d", addr),
+                        entry("REASON=%s", std::strerror(errno)));
+    }
+
+    const uint8_t current = progress;
+    if (current != reportedProgress)
+    {
+        reportedProgress = current;
+        if (onProgress)
+        {
+            onProgress(current);
+        }
+    }
+
+    if (finished && thread.joinable())
+    {
+        thread.join();
+        // NOTE: the handler may destroy this object, so it must be the last
+        //       action here
+        onComplete(succeeded);
+    }
+}
@@ -0,0 +1,130 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ * Copyright (C) 2022, KNS Group LLC (YADRO)
+ */
+
+#pragma once
+
+#include "update_engine.hpp"
+
+#include <sdeventplus/event.hpp>
+#include <sdeventplus/source/io.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+
+/**
+ * @class UpdateWorker
+ *
+ * This class runs backplane MCU firmware update in a separate thread. The
+ * progress and the result are delivered to the main event loop through an
+ * eventfd, so the handlers (and all D-Bus objects) are touched from the main
+ * thread only.
+ */
+class UpdateWorker
+{
+  public:
+    /** @brief Progress handler, receives the progress in percents */
+    using ProgressHandler = std::function<void(uint8_t)>;
+    /** @brief Completion handler, receives the update status */
+    using CompletionHandler = std::function<void(bool)>;
+
+    /** @brief Update mode */
+    enum class Mode
+    {
+        Update,          //!< flash the image unconditionally
+        Reflash,         //!< flash only if MCU runs another version
+        ReflashIfPresent //!< same as Reflash, MCU absence is not an error
+    };
+
+    UpdateWorker(const UpdateWorker&) = delete;
+    UpdateWorker& operator=(const UpdateWorker&) = delete;
+    UpdateWorker(UpdateWorker&&) = delete;
+    UpdateWorker& operator=(UpdateWorker&&) = delete;
+
+    /**
+     * @brief Constructor, starts the update
+     *
+     * @param[in] event - event loop to deliver notifications to
+     * @param[in] devPath - I2C bus device file path
+     * @param[in] addr - 7-bit I2C device address
+     * @param[in] image - firmware image
+     * @param[in] imageVersion - version of the new firmware
+     * @param[in] mode - update mode
+     * @param[in] onProgress - progress handler
+     * @param[in] onComplete - completion handler, the worker may be destroyed
+     *                         from inside of it
+     * @throw std::runtime_error if notification channel can't be created
+     */
+    UpdateWorker(const sdeventplus::Event& event, std::string devPath,
+                 int addr, std::shared_ptr<const FirmwareImage> image,
+                 std::string imageVersion, Mode mode,
+                 ProgressHandler onProgress, CompletionHandler onComplete);
+
+    /**
+     * @brief Destructor, cancels the update and waits for the thread
+     *
+     * The engine checks the cancellation while writing the image, waiting
+     * for the bus and waiting for MCU reboot, so the wait is short.
+     */
+    ~UpdateWorker();
+
+    /**
+     * @brief Request update cancellation
+     *
+     * The flash writing is interrupted before the next chunk, the result is
+     * reported through the completion handler as usual.
+     */
+    void cancel();
+
+    /**
+     * @brief Time taken to write the image, valid after successful update
+     */
+    std::chrono::milliseconds writeTime() const
+    {
+        return writeDuration;
+    }
+
+    /**
+     * @brief Time taken by MCU reboot, valid after successful update
+     */
+    std::chrono::milliseconds rebootTime() const
+    {
+        return rebootDuration;
+    }
+
+  private:
+    void run();
+    bool flashRequired(const MCUUpdateEngine& mcu) const;
+    void notify();
+    void dispatch();
+
+    std::string devPath;
+    int addr;
+    std::shared_ptr<const FirmwareImage> image;
+    std::string imageVersion;
+    Mode mode;
+    ProgressHandler onProgress;
+    CompletionHandler onComplete;
+
+    int eventFd = -1;
+    std::optional<sdeventplus::source::IO> eventSource;
+    std::thread thread;
+
+    std::mutex engineMutex;
+    std::unique_ptr<MCUUpdateEngine> engine;
+    std::atomic_bool cancelled = false;
+
+    std::atomic<uint8_t> progress = 0;
+    std::atomic_bool finished = false;
+    std::atomic_bool succeeded = false;
+    uint8_t reportedProgress = 0;
+    std::chrono::milliseconds writeDuration{0};
+    std::chrono::milliseconds rebootDuration{0};
+};